@@ -0,0 +1,130 @@
+/**
+ * Compact point cache of baked, skinned vertex positions
+ * 
+ * Layout, little endian:
+ *   header  "SPC1", u32 version, u32 vertexCount, u32 frameCount, f32 fps,
+ *           u32 keyframeInterval, f32 boxMin[3], f32 boxMax[3]
+ *   frames  u8 type, u32 payload bytes, payload
+ * 
+ * Positions are quantized to 16 bits per axis inside the box. A key frame
+ * (type 0) stores them as is; a delta frame (type 1) stores, per component,
+ * the difference to the previous frame zigzag-encoded as a LEB128 varint,
+ * mostly a single byte for smooth motion. Deltas are taken between quantized
+ * values, so the error never accumulates. Every `keyframeInterval` frames is
+ * a key frame to allow seeking.
+ * 
+ * PointCacheWriter encodes on the calling thread into one of two buffers
+ * while a writer thread saves the other one, so memory stays at two frames
+ * however long the clip is. PointCacheReader decodes frames in order and
+ * seeks through the key frames.
+ * */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#define POINT_CACHE_VERSION 1
+#define POINT_CACHE_KEY_FRAME 0
+#define POINT_CACHE_DELTA_FRAME 1
+
+class PointCacheWriter
+{
+private:
+    FILE* file = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t frameCount = 0;
+    uint32_t keyframeInterval;
+    glm::vec3 boxMin, boxScale; // quantized = (p - boxMin) * boxScale
+    float maxError = 0.0f;
+    uint64_t bytesWritten = 0;
+
+    std::vector<uint16_t> previous; // quantized positions of the last frame
+    std::vector<uint16_t> current;
+
+    // double buffering: the caller fills `buffers[fill]`, the writer thread
+    // saves the other one while `pending`
+    std::vector<unsigned char> buffers[2];
+    int fill = 0;
+    bool pending = false;
+    bool stopping = false;
+    bool ioFailed = false;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread writer;
+
+    void writerLoop();
+    void encodeFrame(const glm::vec3* _positions, std::vector<unsigned char>& _out);
+
+public:
+    PointCacheWriter() = default;
+    ~PointCacheWriter();
+
+    PointCacheWriter(const PointCacheWriter&) = delete;
+    PointCacheWriter& operator=(const PointCacheWriter&) = delete;
+
+    // Creates the file and starts the writer thread. Every position written
+    // later must lie inside the box.
+    bool open(const std::string& _path, size_t _vertexCount, float _fps, 
+              const glm::vec3& _boxMin, const glm::vec3& _boxMax, 
+              uint32_t _keyframeInterval, std::string& err);
+
+    // Encodes one frame of `vertexCount` positions and queues it, waiting
+    // only while the writer is still busy with the frame before.
+    void writeFrame(const glm::vec3* _positions);
+
+    // Flushes the last frame, completes the header and closes the file.
+    // Returns false when any write failed.
+    bool close(std::string& err);
+
+    uint32_t getFrameCount() const { return frameCount; }
+    uint64_t getBytesWritten() const { return bytesWritten; }
+    // largest distance between a written position and its quantized value
+    float getMaxError() const { return maxError; }
+};
+
+class PointCacheReader
+{
+private:
+    FILE* file = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t frameCount = 0;
+    uint32_t keyframeInterval = 1;
+    float fps = 0.0f;
+    glm::vec3 boxMin, boxScale; // same as the writer's, p = boxMin + quantized / boxScale
+
+    std::vector<long> frameOffsets; // file offset of every frame, found by open()
+    uint32_t nextFrame = 0;
+    std::vector<uint16_t> values;   // quantized positions of the last frame read
+    std::vector<unsigned char> payload;
+
+    bool decodeFrame(std::string& err);
+
+public:
+    PointCacheReader() = default;
+    ~PointCacheReader();
+
+    PointCacheReader(const PointCacheReader&) = delete;
+    PointCacheReader& operator=(const PointCacheReader&) = delete;
+
+    // Reads the header and walks the frame headers. Fails on a cache that
+    // was never closed or is cut short.
+    bool open(const std::string& _path, std::string& err);
+    void close();
+
+    // Decodes the next frame into `vertexCount` positions
+    bool readFrame(glm::vec3* _positions, std::string& err);
+    // Makes `_frame` the next one read, decoding from the key frame before it
+    bool seek(uint32_t _frame, std::string& err);
+
+    uint32_t getVertexCount() const { return vertexCount; }
+    uint32_t getFrameCount() const { return frameCount; }
+    uint32_t getKeyframeInterval() const { return keyframeInterval; }
+    float getFps() const { return fps; }
+};
@@ -9,8 +9,21 @@
 #include <glm/glm.hpp>
 #include <shader/shader.hpp>
 
+#include "camera/frustum.hpp"
+
+// uniform buffer binding point of the `FrameConstants` block, see res/shader/*.vs
+#define FRAME_CONSTANTS_BINDING 0
+
 class FirstPersonCamera
 {
+public:
+    // std140 layout of the `FrameConstants` uniform block
+    struct FrameConstants {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::vec4 camPos;
+    };
+
 private:
     glm::vec3 cameraPos;
     glm::vec3 cameraForward;
@@ -23,10 +36,20 @@ private:
     float nearClipDist;
     float farClipDist;
 
+    FrameConstants frameConstants;
+    GLuint frameUBO = 0;
+
 public:
     FirstPersonCamera();
     void applyToShader(Shader *_shader);
 
+    // Computes projection/view/camPos once per frame and uploads them into the
+    // uniform buffer bound at FRAME_CONSTANTS_BINDING, shared by every shader
+    void updateFrameConstants();
+    const FrameConstants& getFrameConstants() const { return frameConstants; }
+    // frustum of the last updateFrameConstants()
+    Frustum getFrustum() const { return Frustum(frameConstants.projection * frameConstants.view); }
+
     void applyProjection(Shader *_shader);
     void applyView(Shader *_shader);
     void applyCameraPos(Shader *_shader);
@@ -49,5 +72,8 @@ public:
     void rotateRight(float _angle);
     void rotateLeft(float _angle);
 
+    // places the camera at `_position` looking at `_target`, for scripted cameras
+    void lookAt(const glm::vec3& _position, const glm::vec3& _target);
+
     void printInfo();
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+/**
+ * View frustum for culling, extracted from a view-projection matrix
+ * */
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+class Frustum
+{
+private:
+    // left, right, bottom, top, near, far; a point p is inside when dot(plane, (p, 1)) >= 0
+    glm::vec4 planes[6];
+
+public:
+    Frustum();
+    explicit Frustum(const glm::mat4& _viewProjection);
+
+    // `_sphere` packs the center in xyz and the radius in w
+    bool intersectsSphere(const glm::vec4& _sphere) const;
+
+    // Writes 1 into `_visible[i]` for every sphere intersecting the frustum
+    // and 0 otherwise. Tests four spheres per iteration with SSE.
+    void cullSpheres(const glm::vec4* _spheres, size_t _count, unsigned char* _visible) const;
+};
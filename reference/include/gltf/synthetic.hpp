@@ -0,0 +1,38 @@
+/**
+ * Synthetic skinned models for benchmarks and stress tests
+ * 
+ * Builds a complete tinygltf::Model in memory: a joint tree, a skinned mesh
+ * following it and one clip animating every joint (or a share of them), sized by a
+ * SyntheticModelDesc. The model loads through the same loaders as files,
+ * and test/stressgen.cpp writes it out as .gltf or .glb.
+ * */
+#pragma once
+
+#include <string>
+
+#include <tiny_gltf.h>
+
+// animated channels, combine with |
+#define SYNTHETIC_CHANNEL_TRANSLATION 1
+#define SYNTHETIC_CHANNEL_ROTATION 2
+#define SYNTHETIC_CHANNEL_SCALE 4
+
+struct SyntheticModelDesc {
+    int jointCount = 64;
+    int branching = 2;          // children per joint, 1 gives a single chain
+    int maxDepth = 0;           // deepest level below the root, 0 for no limit
+    int vertexCount = 4096;
+    int influences = 4;         // non-zero skin weights per vertex, 1 to 4
+    float duration = 2.0f;      // seconds
+    float keysPerSecond = 30.0f;
+    int channels = SYNTHETIC_CHANNEL_ROTATION;
+    std::string interpolation = "LINEAR"; // LINEAR, STEP or CUBICSPLINE
+    float animatedFraction = 1.0f; // share of joints that move, spread over the tree; the others get constant keys
+};
+
+// Replaces `gltf` with a model described by `desc`. Joints are nodes
+// 0 .. jointCount-1, parents before children, and the skinned mesh is the
+// node right after them. Joints are attached breadth first, `branching` per
+// parent; once every parent within `maxDepth` is full the extra joints are
+// spread over them round robin.
+void tinygltf_buildSyntheticModel(const SyntheticModelDesc& desc, tinygltf::Model& gltf);
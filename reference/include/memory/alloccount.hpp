@@ -0,0 +1,20 @@
+/**
+ * Debug heap allocation counter
+ * 
+ * src/memory/alloccount.cpp replaces the global operator new/delete with
+ * versions that count every allocation. It is not part of libmain, a target
+ * opts in by compiling it in (the bench target does, to check that the
+ * per-frame path sample -> FK -> palette stays off the heap).
+ * */
+#pragma once
+
+#include <cstddef>
+
+class AllocationCounter
+{
+public:
+    // operator new calls made by the calling thread so far
+    static size_t getThreadCount();
+    // operator new calls made by every thread so far
+    static size_t getTotalCount();
+};
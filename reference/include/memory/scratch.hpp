@@ -0,0 +1,74 @@
+/**
+ * Per-thread frame scratch memory
+ * 
+ * A bump allocator for temporaries that only live during a call, like the
+ * local rotations between sampling and forward kinematics. Memory is handed
+ * out of a few large blocks and given back by rewinding, so once the blocks
+ * have grown to the frame's high-water mark nothing touches the heap again.
+ * 
+ *   ScratchScope scope;                          // rewinds on destruction
+ *   glm::quat* rotations = scope.allocate<glm::quat>(boneCount);
+ * 
+ * Only trivially destructible types, nothing is constructed or destroyed.
+ * */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// size of the first block of every thread's scratch
+#define FRAME_SCRATCH_BLOCK_SIZE (64 * 1024)
+
+class FrameScratch
+{
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t block = 0;   // block currently allocated from
+    size_t offset = 0;  // first free byte in it
+
+public:
+    struct Marker {
+        size_t block;
+        size_t offset;
+    };
+
+    // the calling thread's scratch
+    static FrameScratch& get();
+
+    void* allocate(size_t _bytes, size_t _alignment);
+    template<typename T>
+    T* allocate(size_t _count) {
+        static_assert(std::is_trivially_destructible_v<T>, "scratch memory is never destroyed");
+        return static_cast<T*>(this->allocate(_count * sizeof(T), alignof(T)));
+    }
+
+    Marker mark() const { return { this->block, this->offset }; }
+    // frees everything allocated since `_marker`, blocks are kept for reuse
+    void rewind(const Marker& _marker);
+
+    size_t getCapacity() const;
+};
+
+// scratch allocations of the enclosing block
+class ScratchScope
+{
+private:
+    FrameScratch& scratch;
+    FrameScratch::Marker marker;
+
+public:
+    ScratchScope() : scratch(FrameScratch::get()), marker(scratch.mark()) {}
+    ~ScratchScope() { this->scratch.rewind(this->marker); }
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    template<typename T>
+    T* allocate(size_t _count) { return this->scratch.allocate<T>(_count); }
+};
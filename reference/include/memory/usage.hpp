@@ -0,0 +1,21 @@
+/**
+ * Process memory usage
+ * 
+ * Resident is what the process holds right now, peak the high-water mark
+ * since it started. Loading frees its intermediate data, so the two differ
+ * by how much a load briefly needed on top of what it kept.
+ * */
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+
+struct MemoryUsage {
+    size_t resident = 0;    // bytes, 0 where the platform does not report it
+    size_t peak = 0;        // bytes, 0 where the platform does not report it
+};
+
+MemoryUsage getMemoryUsage();
+
+// "resident 12.3 MiB, peak 45.6 MiB"
+std::ostream& operator<<(std::ostream& _out, const MemoryUsage& _usage);
@@ -0,0 +1,110 @@
+/**
+ * Multi-draw-indirect renderer for every skinned mesh in the scene
+ * 
+ * The geometry of all registered meshes is merged into one vertex arena and
+ * one index arena behind a single VAO. Each frame the submitted instances are
+ * grouped per mesh into one indirect command each, and the whole frame is
+ * drawn by a single glMultiDrawElementsIndirect. The shader finds its per-draw
+ * data with gl_DrawID. Check "res/shader/batch.vs"
+ * */
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera/fpc.hpp"
+#include "pipeline/buffer.hpp"
+#include "pipeline/queue.hpp"
+#include "shader/shader.hpp"
+#include "skeletal/half.hpp"
+#include "skeletal/mesh.hpp"
+
+// shader storage binding points, see res/shader/batch.vs
+#define BATCH_DRAW_BINDING 4
+#define BATCH_MODEL_BINDING 5
+#define BATCH_PALETTE_BINDING 6
+
+class SkinnedMeshBatcher
+{
+private:
+    typedef struct VertexData { // batch.vs
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::uvec4 influences;
+        glm::vec4 weights;
+    } VertexData;
+
+    // layout fixed by glMultiDrawElementsIndirect
+    typedef struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    } DrawCommand;
+
+    // std430 `DrawData` in batch.vs, one per command
+    typedef struct DrawData {
+        GLuint firstInstance; // into the model array
+        GLuint paletteBase;   // into the palette array
+        GLuint boneCount;
+        GLuint padding;
+    } DrawData;
+
+    // a mesh's slice of the arenas and the instances submitted this frame
+    struct MeshSlot {
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+        size_t boneCount;
+        std::vector<glm::mat4> models;
+        std::vector<const glm::mat4*> palettes; // borrowed until record()
+    };
+
+    struct GLO {
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+        GLuint EBO = 0;
+    } glo;
+    StreamingBuffer commandStream;
+    StreamingBuffer drawStream;
+    StreamingBuffer modelStream;
+    StreamingBuffer paletteStream;
+
+    std::vector<VertexData> vertexArena; // released by build()
+    std::vector<unsigned int> indexArena;
+    std::vector<MeshSlot> meshes;
+
+    // scratch reused every frame
+    std::vector<DrawCommand> commands;
+    std::vector<DrawData> drawData;
+    std::vector<glm::mat4> models;
+    std::vector<glm::mat4> palettes; // only without a persistent mapping
+    std::vector<HalfMat4> halfPalettes;
+
+    Shader* shader;
+    FirstPersonCamera* camera;
+    GLint drawIndexLocation; // only used without gl_DrawID
+    bool hasDrawID = false;
+    bool halfPalette;
+
+public:
+    SkinnedMeshBatcher(
+        Shader* _shader, 
+        FirstPersonCamera* _camera,
+        bool _halfPalette = false // uploads the palettes as halves, `_shader` must be batch_half.vs
+    );
+
+    // Appends the mesh to the arenas, returns its id for submit(). Every
+    // mesh must be added before build().
+    int addMesh(const BoneWeightedMesh* _mesh, size_t _boneCount);
+    // uploads the arenas into immutable buffers
+    void build();
+
+    // queues one instance for this frame, `_palette` holds the mesh's boneCount
+    // matrices and is read by record(), keep it alive until then
+    void submit(int _meshId, const glm::mat4& _model, const glm::mat4* _palette);
+    // records every submitted instance as one multi-draw and clears the submissions
+    void record(RenderQueue& queue);
+};
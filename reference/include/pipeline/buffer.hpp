@@ -0,0 +1,66 @@
+/**
+ * Buffer helpers shared by the pipelines
+ * 
+ * StreamingBuffer is a ring of persistently mapped regions for data that
+ * changes every frame (joint positions, bone palettes, ...). The CPU writes
+ * one region while the GPU may still read the other two, and a fence per
+ * region keeps us from overwriting data that is still in flight.
+ * 
+ * Requires glBufferStorage (OpenGL 4.4), on older contexts the regions are
+ * filled with glBufferSubData instead.
+ * */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+#define STREAMING_BUFFER_REGIONS 3
+
+// Allocates the storage of the buffer bound to `_target`. Immutable when
+// glBufferStorage is available, use it for geometry uploaded exactly once.
+void allocateStaticStorage(GLenum _target, GLsizeiptr _size, const void* _data);
+
+class StreamingBuffer
+{
+private:
+    GLuint buffer = 0;
+    GLenum target;
+    size_t alignment;
+    size_t regionSize = 0;          // capacity of one region in bytes
+    unsigned char* mapped = nullptr; // persistent mapping, null on the fallback path
+    GLsync fences[STREAMING_BUFFER_REGIONS] = {};
+    int region = 0;                 // region written this frame
+    size_t head = 0;                // bytes already written into it
+    std::vector<GLuint> retired;    // outgrown this frame, deleted on commit
+
+    void allocate(size_t _regionSize);
+    void release();
+    void grow(size_t _needed);
+    size_t place(size_t _size);
+    void waitFence(int _region);
+
+public:
+    StreamingBuffer(GLenum _target, size_t _regionSize);
+    ~StreamingBuffer();
+
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    // Copies `_size` bytes into the current region and returns their offset
+    // in the buffer. When the region is full the buffer is replaced by a
+    // larger one, so query getBuffer() right after the write. The outgrown
+    // buffer stays valid for offsets handed out before until commit().
+    GLintptr write(const void* _data, size_t _size);
+    // Like write() but hands out the mapped bytes to fill in place, the
+    // same frame and before the draws reading them are submitted. Returns
+    // null on the glBufferSubData fallback, use write() there.
+    void* reserve(size_t _size, GLintptr& _offset);
+
+    // Fences the current region after the draws reading it have been issued
+    // and moves on to the next one. Call once per frame.
+    void commit();
+
+    GLuint getBuffer() const { return buffer; }
+};
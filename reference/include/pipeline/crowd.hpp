@@ -0,0 +1,72 @@
+/**
+ * Instanced renderer for crowds of one skinned mesh
+ * 
+ * All instances are drawn with a single glDrawElementsInstanced, each
+ * instance fetches its model matrix and bone palette from shader storage
+ * buffers by gl_InstanceID. Check "res/shader/crowd.vs"
+ * */
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera/fpc.hpp"
+#include "pipeline/buffer.hpp"
+#include "pipeline/queue.hpp"
+#include "shader/shader.hpp"
+#include "skeletal/half.hpp"
+#include "skeletal/mesh.hpp"
+
+// shader storage binding points, see res/shader/crowd.vs
+#define CROWD_MODEL_BINDING 1
+#define CROWD_PALETTE_BINDING 2
+
+class CrowdMeshPipeline
+{
+private:
+    typedef struct VertexData { // crowd.vs
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::uvec4 influences;
+        glm::vec4 weights;
+    } VertexData;
+
+    struct GLO {
+        GLuint VAO;
+        GLuint VBO;
+        GLuint EBO;
+    } glo;
+    StreamingBuffer modelStream;   // one mat4 per instance
+    StreamingBuffer paletteStream; // boneCount mat4 per instance, instance-major
+    std::vector<HalfMat4> halfPalettes; // packed here only without a persistent mapping
+    GLintptr modelOffset = 0;
+    GLintptr paletteOffset = 0;
+
+    size_t indexCount;
+    size_t boneCount;
+    size_t instanceCount = 0;
+    bool halfPalette;
+
+    Shader* shader;
+    FirstPersonCamera* camera;
+
+public:
+    CrowdMeshPipeline(
+        Shader* _shader, 
+        FirstPersonCamera* _camera,
+        BoneWeightedMesh* _mesh,
+        size_t _boneCount,
+        bool _halfPalette = false // uploads the palettes as halves, `_shader` must be crowd_half.vs
+    );
+
+    size_t getBoneCount() const { return boneCount; }
+    size_t getInstanceCount() const { return instanceCount; }
+
+    // `_palettes` holds `getBoneCount()` skinning matrices per model matrix,
+    // with a half palette they are packed on the way into the stream
+    void setInstances(const std::vector<glm::mat4>& _models, const std::vector<glm::mat4>& _palettes);
+
+    // records the whole crowd as one instanced draw
+    void record(RenderQueue& queue);
+};
@@ -8,11 +8,19 @@
 #include <eigen3/Eigen/Geometry>
 
 #include "camera/fpc.hpp"
+#include "pipeline/buffer.hpp"
+#include "pipeline/queue.hpp"
 #include "shader/shader.hpp"
+#include "skeletal/animator.hpp"
+#include "skeletal/half.hpp"
 #include "skeletal/mesh.hpp"
 
 #define MAX_BONE_INFLUENCE 4
 
+// shader storage binding point of the bone palette, see res/shader/mesh.vs
+// (res/shader/mesh_half.vs for a half-float palette)
+#define MESH_PALETTE_BINDING 3
+
 class WireframeMeshPipeline
 {
 private:
@@ -34,21 +42,28 @@ private:
         GLuint VBO;
         GLuint EBO;
     } glo;
+    StreamingBuffer paletteStream; // bone palette, rewritten every frame
 
     std::vector<VertexData> vertices;
     std::vector<unsigned int> indices;
+    std::vector<glm::mat4> palette;
+    std::vector<HalfMat4> halfPalette; // uploaded instead of `palette` when not empty
 
     Shader* shader;
     FirstPersonCamera* camera;
+    SkeletalAnimator* anim;
 
 public:
     WireframeMeshPipeline(
         Shader* _shader, 
         FirstPersonCamera* _camera,
-        BoneWeightedMesh* _mesh
+        BoneWeightedMesh* _mesh,
+        SkeletalAnimator* _anim,
+        bool _halfPalette = false // uploads the palette as halves, `_shader` must unpack it like mesh_half.vs
     );
 
-    void draw();
+    // skins at `time` and records the draw into `queue`
+    void record(RenderQueue& queue, float time);
 };
 
 /***************************my code end*************************/
\ No newline at end of file
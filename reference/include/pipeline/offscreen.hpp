@@ -0,0 +1,83 @@
+/**
+ * Offscreen rendering and frame readback
+ * 
+ * OffscreenTarget is a framebuffer with an RGBA8 color and a depth
+ * attachment, for rendering without a window. FrameReadback copies the color
+ * of finished frames into a ring of pixel pack buffers: glReadPixels into a
+ * PBO returns at once, and the pixels are mapped a few frames later when the
+ * copy is done, so the GPU keeps rendering while older frames are saved.
+ * */
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <glad/glad.h>
+
+#define READBACK_BUFFERS 3
+
+class OffscreenTarget
+{
+private:
+    GLuint framebuffer = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+    int width;
+    int height;
+
+public:
+    OffscreenTarget(int _width, int _height);
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    bool isComplete() const;
+    // binds the framebuffer for drawing and reading and sets the viewport
+    void bind();
+
+    GLuint getFramebuffer() const { return framebuffer; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
+
+class FrameReadback
+{
+public:
+    // rows are bottom-up like OpenGL returns them, 4 bytes per pixel
+    typedef std::function<void(int _frame, const unsigned char* _rgba, int _width, int _height)> Callback;
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        int frame = -1;  // frame held by the buffer, -1 when free
+    };
+
+    Slot slots[READBACK_BUFFERS];
+    int next = 0;
+    int width;
+    int height;
+
+    // maps the slot's pixels and hands them to `_callback`, waiting for the copy if `_wait`
+    bool deliver(Slot& _slot, const Callback& _callback, bool _wait);
+
+public:
+    FrameReadback(int _width, int _height);
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // Queues a copy of the bound read framebuffer as `_frame`. When every
+    // buffer is still busy, the oldest frame is delivered first.
+    void capture(int _frame, const Callback& _callback);
+    // delivers the frames whose copy is done, never blocks
+    void poll(const Callback& _callback);
+    // delivers every pending frame
+    void flush(const Callback& _callback);
+};
+
+// Binary PPM of a bottom-up RGBA image, flipped so that it reads top-down.
+// Returns false when the file can not be written.
+bool writeImagePPM(const std::string& _path, const unsigned char* _rgba, int _width, int _height);
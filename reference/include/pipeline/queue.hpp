@@ -0,0 +1,124 @@
+/**
+ * Deferred draw submission with GL state caching
+ * 
+ * Pipelines record DrawPackets instead of drawing right away. RenderQueue
+ * sorts the packets by a key built from program, VAO and polygon mode so
+ * that draws sharing state end up next to each other, then submits them
+ * through GLStateCache which skips every bind that would not change anything.
+ * */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "pipeline/buffer.hpp"
+
+#define DRAW_PACKET_MAX_STORAGE 4
+#define STATE_CACHE_MAX_STORAGE_BINDINGS 16
+
+struct DrawPacket {
+    enum Kind {
+        Elements,               // glDrawElementsInstanced
+        MultiElementsIndirect,  // glMultiDrawElementsIndirect
+    };
+
+    // a shader storage range bound with glBindBufferRange
+    struct StorageRange {
+        GLuint binding;
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    Kind kind = Elements;
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLenum polygonMode = GL_LINE;
+    GLenum primitive = GL_TRIANGLES;
+
+    // optional vertex buffer for binding point 0, for VAOs using glVertexAttribFormat
+    GLuint vertexBuffer = 0;
+    GLintptr vertexOffset = 0;
+    GLsizei vertexStride = 0;
+
+    StorageRange storage[DRAW_PACKET_MAX_STORAGE];
+    int storageCount = 0;
+
+    // Elements: index count and instances
+    GLsizei count = 0;
+    GLsizei instanceCount = 1;
+
+    // MultiElementsIndirect: `count` commands read from the indirect buffer
+    GLuint indirectBuffer = 0;
+    GLintptr indirectOffset = 0;
+    GLsizei indirectStride = 0;
+    // without gl_DrawID the commands are issued one by one with their index in this uniform
+    GLint drawIndexLocation = -1;
+
+    void addStorage(GLuint _binding, GLuint _buffer, GLintptr _offset, GLsizeiptr _size) {
+        storage[storageCount++] = { _binding, _buffer, _offset, _size };
+    }
+};
+
+// Mirrors the GL state set by the queue, binds only on change
+class GLStateCache
+{
+private:
+    struct StorageBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    GLuint program;
+    GLuint vao;
+    GLenum polygonMode;
+    GLuint vertexBuffer; // binding point 0 of the current VAO
+    GLintptr vertexOffset;
+    GLsizei vertexStride;
+    GLuint indirectBuffer;
+    StorageBinding storage[STATE_CACHE_MAX_STORAGE_BINDINGS];
+
+public:
+    GLStateCache() { invalidate(); }
+
+    // forget everything, call after code outside the queue changed GL state
+    void invalidate();
+
+    void useProgram(GLuint _program);
+    void bindVertexArray(GLuint _vao);
+    void setPolygonMode(GLenum _mode);
+    void bindVertexBuffer(GLuint _buffer, GLintptr _offset, GLsizei _stride);
+    void bindStorageRange(GLuint _binding, GLuint _buffer, GLintptr _offset, GLsizeiptr _size);
+    void bindIndirectBuffer(GLuint _buffer);
+};
+
+class RenderQueue
+{
+private:
+    struct Entry {
+        uint64_t key;
+        size_t packet;
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<Entry> entries;
+    std::vector<StreamingBuffer*> streams;
+    GLStateCache state;
+
+    static uint64_t sortKey(const DrawPacket& _packet);
+
+public:
+    void record(const DrawPacket& _packet);
+
+    // Streams read by the recorded packets. They are committed (fenced) after
+    // submission, a fence placed before the draws would not protect anything.
+    void addStream(StreamingBuffer* _stream);
+
+    // sorts, draws and clears everything recorded this frame
+    void submit();
+
+    GLStateCache& getState() { return state; }
+};
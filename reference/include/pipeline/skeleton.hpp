@@ -14,6 +14,8 @@
 #include <eigen3/Eigen/Geometry>
 
 #include "camera/fpc.hpp"
+#include "pipeline/buffer.hpp"
+#include "pipeline/queue.hpp"
 #include "shader/shader.hpp"
 #include "skeletal/skeleton.hpp"
 #include "skeletal/animator.hpp"
@@ -28,12 +30,13 @@ private:
 
     struct GLO {
         GLuint VAO;
-        GLuint VBO;
         GLuint EBO;
     } glo;
+    StreamingBuffer vertexStream; // joint positions, rewritten every frame
 
     std::vector<unsigned int> indices;
     std::vector<VertexData> vertices;
+    std::vector<glm::mat4> globals;
 
     Shader* shader;
     FirstPersonCamera* camera;
@@ -48,7 +51,8 @@ public:
         SkeletalAnimator* _anim 
     );
 
-    void draw(float time);
+    // updates the joint positions and records the draw into `queue`
+    void record(RenderQueue& queue, float time);
 
 private:
     void setupIndices();
@@ -0,0 +1,37 @@
+/**
+ * Window-less OpenGL context
+ * 
+ * Creates a core profile context through EGL without any surface, so it runs
+ * on machines without a display server or GPU (Mesa's llvmpipe does the
+ * rendering there). Draw into an FBO, see "pipeline/offscreen.hpp".
+ * 
+ * The Mesa surfaceless platform is preferred when the EGL client offers it,
+ * otherwise the default display is used.
+ * */
+#pragma once
+
+#include <string>
+
+#include <EGL/egl.h>
+
+class HeadlessContext
+{
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Creates the context, makes it current and loads the GL entry points
+    // through glad. Returns false and fills `err` when any step fails.
+    bool create(int _major, int _minor, std::string& err);
+    void destroy();
+
+    // GL_RENDERER of the context, e.g. "llvmpipe (LLVM 15.0.7, 256 bits)"
+    std::string getRenderer() const;
+};
@@ -0,0 +1,129 @@
+/**
+ * Frame profiler
+ * 
+ * CPU zones are scoped: a PROFILE_ZONE("name") records the time until the
+ * end of its block. GPU zones bracket GL commands with GL_TIMESTAMP queries
+ * that are read back a few frames later, so the CPU never waits on them.
+ * Everything is kept in memory and written as Chrome trace-event JSON,
+ * open it in chrome://tracing or https://ui.perfetto.dev
+ * 
+ * Zone names must be string literals (or outlive the profiler), only the
+ * pointer is stored. While the profiler is disabled a zone costs one branch.
+ * */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// frames of GPU queries in flight before their results are read back
+#define PROFILER_GPU_FRAMES 4
+
+class Profiler
+{
+private:
+    struct Event {
+        const char* name;
+        uint32_t thread;    // trace tid, PROFILER_GPU_THREAD for GPU zones
+        int64_t start;      // ns since the profiler's epoch
+        int64_t duration;   // ns
+    };
+
+    struct GpuZone {
+        const char* name;
+        GLuint queries[2];  // begin/end timestamps
+    };
+
+    bool enabled = false;
+    std::chrono::steady_clock::time_point epoch;
+    size_t maxEvents = 0;
+    size_t droppedEvents = 0;
+    std::vector<Event> events;
+    std::mutex eventMutex;
+
+    // GPU zones of the last PROFILER_GPU_FRAMES frames, one list per frame
+    std::vector<GpuZone> gpuFrames[PROFILER_GPU_FRAMES];
+    std::vector<GLuint> freeQueries;
+    std::vector<size_t> openGpuZones; // indices into the current frame's list
+    int gpuFrame = 0;
+    bool gpuCalibrated = false;
+    int64_t gpuOffset = 0;  // CPU time - GPU time, ns
+
+    int64_t now() const;
+    GLuint allocateQuery();
+    void collectGpuFrame(int _frame, bool _wait);
+    void calibrateGpu();
+
+public:
+    static Profiler& get();
+
+    // Starts recording with room for `_maxEvents` events, nothing is
+    // allocated after that and further events are dropped.
+    void enable(size_t _maxEvents = 1 << 20);
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Call once per frame with the GL context current: reads back the GPU
+    // zones recorded PROFILER_GPU_FRAMES frames ago.
+    void beginFrame();
+
+    // CPU zone, normally through ProfileZone
+    void record(const char* _name, int64_t _start, int64_t _end);
+    int64_t timestamp() const { return now(); }
+
+    // GPU zones nest like CPU zones and must be closed in the same frame
+    void beginGpuZone(const char* _name);
+    void endGpuZone();
+
+    // Waits for the GPU zones still in flight and writes every event.
+    // Returns false when the file can not be written.
+    bool writeChromeTrace(const std::string& _path);
+};
+
+class ProfileZone
+{
+private:
+    const char* name;
+    int64_t start;
+
+public:
+    explicit ProfileZone(const char* _name) : name(_name), start(-1) {
+        if (Profiler::get().isEnabled())
+            this->start = Profiler::get().timestamp();
+    }
+    ~ProfileZone() {
+        if (this->start >= 0)
+            Profiler::get().record(this->name, this->start, Profiler::get().timestamp());
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+class GpuProfileZone
+{
+private:
+    bool active;
+
+public:
+    explicit GpuProfileZone(const char* _name) : active(Profiler::get().isEnabled()) {
+        if (this->active)
+            Profiler::get().beginGpuZone(_name);
+    }
+    ~GpuProfileZone() {
+        if (this->active)
+            Profiler::get().endGpuZone();
+    }
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -17,48 +18,103 @@ public:
 
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
 
+    // Linked programs are cached on disk with glGetProgramBinary and reloaded
+    // on the next launch when the sources and the driver are unchanged.
+    // An empty directory disables the cache.
+    static void setBinaryCacheDir(const std::string& dir) { binaryCacheDir = dir; }
+
+    // A uniform location resolved once. Setting it through the handle needs
+    // neither a string lookup nor a driver query, use it on per-frame paths.
+    template <typename T>
+    struct Uniform {
+        GLint location = -1;
+
+        bool valid() const { return location != -1; }
+        void set(const T& value) const { upload(location, value); }
+        // for uniform arrays such as bone palettes
+        void set(const T* values, GLsizei count) const { upload(location, values, count); }
+    };
+
+    template <typename T>
+    Uniform<T> getUniform(const std::string &name) const { return { getUniformLocation(name) }; }
+
+    // looks up the table reflected at link time, -1 if the uniform is not active
+    GLint getUniformLocation(const std::string &name) const {
+        auto it = uniformLocations.find(name);
+        return it == uniformLocations.end() ? -1 : it->second;
+    }
+
     // activate the shader
     void use() const { glUseProgram(ID);}
     void setBool(const std::string &name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     void setInt(const std::string &name, int value) const { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     void setFloat(const std::string &name, float value) const { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     void setVec2(const std::string &name, const glm::vec2 &value) const { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(getUniformLocation(name), x, y); 
     }
     void setVec3(const std::string &name, const glm::vec3 &value) const { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(getUniformLocation(name), x, y, z); 
     }
     void setVec4(const std::string &name, const glm::vec4 &value) const { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(getUniformLocation(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(getUniformLocation(name), x, y, z, w); 
     }
     void setMat2(const std::string &name, const glm::mat2 &mat) const {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     void setMat3(const std::string &name, const glm::mat3 &mat) const {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     void setMat4(const std::string &name, const glm::mat4 &mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     void setTransMat4(const std::string &name, const Eigen::Affine3f &trans) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, trans.matrix().data());
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, trans.matrix().data());
     }
 private:
+    static inline std::string binaryCacheDir = "shader_cache";
+
+    // every active uniform (and array element) of the linked program
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    static void upload(GLint location, bool value) { glUniform1i(location, (int)value); }
+    static void upload(GLint location, int value) { glUniform1i(location, value); }
+    static void upload(GLint location, float value) { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::mat2 &mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const glm::mat3 &mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const glm::mat4 &mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const int *values, GLsizei count) { glUniform1iv(location, count, values); }
+    static void upload(GLint location, const float *values, GLsizei count) { glUniform1fv(location, count, values); }
+    static void upload(GLint location, const glm::vec2 *values, GLsizei count) { glUniform2fv(location, count, &values[0][0]); }
+    static void upload(GLint location, const glm::vec3 *values, GLsizei count) { glUniform3fv(location, count, &values[0][0]); }
+    static void upload(GLint location, const glm::vec4 *values, GLsizei count) { glUniform4fv(location, count, &values[0][0]); }
+    static void upload(GLint location, const glm::mat4 *values, GLsizei count) { glUniformMatrix4fv(location, count, GL_FALSE, &values[0][0][0]); }
+
     // utility function for checking shader compilation/linking errors.
     void checkCompileErrors(GLuint shader, std::string type); 
+
+    void compileProgram(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode, const std::string& cachePath);
+    void reflectUniforms();
+
+    // program binary cache, keyed by the source hash and the driver strings
+    std::string binaryCachePath(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode) const;
+    bool loadProgramBinary(const std::string& cachePath);
+    void saveProgramBinary(const std::string& cachePath) const;
 };
\ No newline at end of file
@@ -12,10 +12,14 @@
 
 #include <iostream>
 #include <vector>
+#include <memory_resource>
 /***********************my code*****************************/
 #include <skeletal/skeleton.hpp>
 /***********************my code end*****************************/
+#include "skeletal/half.hpp"
 
+struct SkeletonLODLevel;
+struct AnimationLayer;
 
 /***********************my code*****************************/
 struct Keyframes {
@@ -23,11 +27,77 @@ struct Keyframes {
     glm::vec3 positions;
 };
 
+// lookup buckets per keyframe in a TimeTable
+#define TIME_LOOKUP_BUCKETS_PER_KEY 2
+
 struct TimeTable {
-    std::vector < float > ftime; // represent the time of each keyframe
+    std::pmr::vector < float > ftime; // represent the time of each keyframe
+    // The time range cut in uniform buckets, each holding a keyframe at or
+    // before its start, so findKey() jumps close and steps forward.
+    std::pmr::vector < unsigned int > lookup;
+    float lookupScale = 0.0f;        // buckets per second
+
+    explicit TimeTable(std::pmr::memory_resource* _resource = std::pmr::get_default_resource()) : ftime(_resource), lookup(_resource) {}
+    TimeTable(const TimeTable& _other, std::pmr::memory_resource* _resource) :
+        ftime(_other.ftime, _resource), lookup(_other.lookup, _resource), lookupScale(_other.lookupScale) {}
+    TimeTable(TimeTable&& _other, std::pmr::memory_resource* _resource) :
+        ftime(std::move(_other.ftime), _resource), lookup(std::move(_other.lookup), _resource), lookupScale(_other.lookupScale) {}
+    TimeTable(const TimeTable&) = default;
+    TimeTable(TimeTable&&) = default;
+    TimeTable& operator=(const TimeTable&) = default;
+    TimeTable& operator=(TimeTable&&) = default;
+
+    // fills `lookup` once `ftime` is loaded
+    void buildLookup();
+    // index of the last keyframe at or before `_time` (0 before the first), without a search
+    size_t findKey(float _time) const;
+    // lookup bucket holding `_time`, clamped to the table
+    size_t getBucket(float _time) const;
 };
 /***********************my code end*****************************/
 
+// glTF sampler interpolation of a track
+enum class Interpolation : unsigned char {
+    Linear,         // slerp between keys
+    Step,           // hold each key until the next
+    CubicSpline     // Hermite spline through the keys, see AnimationClip::splines
+};
+
+// one glTF animation: rotation keys per joint on a time table shared by its channels
+struct AnimationClip {
+    std::pmr::string name;
+    std::pmr::vector< std::pmr::vector< Keyframes > > keyframes; // per joint, empty when not animated
+    TimeTable timetable;
+    std::pmr::vector< unsigned char > constant; // per joint, 1 when its rotation never changes (no keys, or all equal)
+    std::pmr::vector< Interpolation > interpolation; // per joint
+    // Per joint, CUBICSPLINE tracks only: the Hermite segment between keys k
+    // and k+1 as a polynomial in s = 0..1, three coefficients a, b, c per
+    // segment, rotation = normalize(((a s + b) s + c) s + key k).
+    std::pmr::vector< std::pmr::vector< glm::quat > > splines;
+    // per joint, the rotation keys as halves when loaded with `_halfKeys` or
+    // after SkeletalAnimator::compressKeyframes, `keyframes` is empty then
+    std::pmr::vector< std::pmr::vector< HalfQuat > > halfKeys;
+
+    size_t getKeyCount(int _joint) const { return halfKeys.empty() ? keyframes[_joint].size() : halfKeys[_joint].size(); }
+    glm::quat getKey(int _joint, size_t _key) const {
+        return halfKeys.empty() ? keyframes[_joint][_key].orientation : unpackQuat(halfKeys[_joint][_key]);
+    }
+
+    float getDuration() const { return timetable.ftime.empty() ? 0.0f : timetable.ftime.back(); }
+
+    // allocator-aware, so the keys live in the animator's memory resource
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    AnimationClip() = default;
+    explicit AnimationClip(const allocator_type& _alloc) : name(_alloc), keyframes(_alloc), timetable(_alloc.resource()), constant(_alloc), interpolation(_alloc), splines(_alloc), halfKeys(_alloc) {}
+    AnimationClip(const AnimationClip& _other, const allocator_type& _alloc);
+    AnimationClip(AnimationClip&& _other, const allocator_type& _alloc);
+    AnimationClip(const AnimationClip&) = default;
+    AnimationClip(AnimationClip&&) = default;
+    AnimationClip& operator=(const AnimationClip&) = default;
+    AnimationClip& operator=(AnimationClip&&) = default;
+};
+
 class SkeletalAnimator
 {
     ////////////
@@ -35,18 +105,83 @@ class SkeletalAnimator
     // generate animations by interpolation
     ////////////
 
-/***********************my code*****************************/
 private:
-    std::vector< std::vector< Keyframes > > keyframes; // using index to represent the node id.
-    TimeTable timetable;
-/***********************my code end*****************************/
+    std::pmr::vector< AnimationClip > clips; // every animation of the file, in file order
+    const Skeleton* skeleton = nullptr;
+    HalfPrecisionError keyframeError; // of the half-float keys, empty with float keys
+
+    bool loadClip(
+        const tinygltf::Model& mdl,
+        const tinygltf::Animation& gltfAnim,
+        AnimationClip& clip,
+        std::string& warn,
+        std::string& err
+    );
+    // local rotations of `_joints` from `_clip` at `_time`
+    void sampleJoints(const AnimationClip& _clip, float _time, const int* _joints, size_t _jointCount, glm::quat* rotations) const;
+    void applyInverseBind(glm::mat4* palette, const SkeletonLODLevel* lod) const;
+    // moves `clip`'s rotation keys into `halfKeys`, in the clip's own allocator
+    static void compressClip(AnimationClip& clip, HalfPrecisionError& error);
+
 public:
+    // Keyframes and times are allocated from `_resource`, which must outlive
+    // the animator. See estimateLoadBytes() to size an arena for it.
+    explicit SkeletalAnimator(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+
+    // bytes loadFromTinyGLTF allocates for `mdl`, from the accessor counts
+    static size_t estimateLoadBytes(const tinygltf::Model& mdl, bool _halfKeys = false);
+
+    // With `_halfKeys` rotation keys are stored as halves (see skeletal/half.hpp):
+    // each clip is loaded on the heap and only its halves are kept in the
+    // animator's resource, so an arena never holds the float keys.
     bool loadFromTinyGLTF(
         const tinygltf::Model& mdl,
         std::string& warn,
         std::string& err,
-        Skeleton* _skel // using skeleton.getjoints() to get the data of original data of joints.
+        Skeleton* _skel, // using skeleton.getjoints() to get the data of original data of joints.
+        bool _halfKeys = false
     );
-    const auto& getKeyframes() const { return keyframes; }
-    const auto& getTimetable() const { return timetable; }
+    size_t getClipCount() const { return clips.size(); }
+    const AnimationClip& getClip(int clip) const { return clips[clip]; }
+    // index of the clip named `name`, -1 if there is none
+    int findClip(const std::string& name) const;
+
+    // Stores every clip's rotation keys as halves after loading and returns
+    // what that costs in precision. Spline coefficients stay floats. The
+    // float keys go back to the animator's resource, which a monotonic arena
+    // never reuses: load arena-backed animators with `_halfKeys` instead.
+    HalfPrecisionError compressKeyframes();
+    // precision lost to half-float keys, by loading or compressKeyframes
+    const HalfPrecisionError& getKeyframeError() const { return keyframeError; }
+    // bytes held by rotation keys, float or half
+    size_t getKeyframeBytes() const;
+
+    // the first clip, what the single-clip evaluation below plays (no keys once compressed)
+    const auto& getKeyframes() const { return clips[0].keyframes; }
+    const auto& getTimetable() const { return clips[0].timetable; }
+    const Skeleton* getSkeleton() const { return skeleton; }
+    float getDuration(int clip = 0) const { return clips.empty() ? 0.0f : clips[clip].getDuration(); }
+
+    // Pose evaluation at an arbitrary `time` in seconds, clamped to the clip.
+    // Every output array holds one entry per joint of the skeleton. With a
+    // skeleton `lod` level only its evaluated joints are sampled and solved,
+    // skipped joints follow their proxy joint rigidly.
+
+    // local rotation of every joint in the first clip, slerped between the
+    // surrounding keyframes (left untouched for joints skipped by `lod`)
+    void sampleRotations(float time, glm::quat* rotations, const SkeletonLODLevel* lod = nullptr) const;
+    // the same from any clip, or for the listed joints only
+    void sampleClip(int clip, float time, glm::quat* rotations, const SkeletonLODLevel* lod = nullptr) const;
+    void sampleClip(int clip, float time, const int* joints, size_t jointCount, glm::quat* rotations) const;
+    // local rotation of every joint from a stack of layers, see skeletal/blend.hpp.
+    // Joints no layer covers stay at the bind pose.
+    void blendLayers(const AnimationLayer* layers, size_t layerCount, glm::quat* rotations, const SkeletonLODLevel* lod = nullptr) const;
+
+    // global transform of every joint (forward kinematics), from the first clip or from local rotations
+    void computeGlobalTransforms(float time, glm::mat4* globals, const SkeletonLODLevel* lod = nullptr) const;
+    void computeGlobalTransforms(const glm::quat* rotations, glm::mat4* globals, const SkeletonLODLevel* lod = nullptr) const;
+    // skinning matrix of every joint: global * inverse bind, from the first clip, layers or local rotations
+    void computeBonePalette(float time, glm::mat4* palette, const SkeletonLODLevel* lod = nullptr) const;
+    void computeBonePalette(const AnimationLayer* layers, size_t layerCount, glm::mat4* palette, const SkeletonLODLevel* lod = nullptr) const;
+    void computeBonePalette(const glm::quat* rotations, glm::mat4* palette, const SkeletonLODLevel* lod = nullptr) const;
 };
\ No newline at end of file
@@ -0,0 +1,53 @@
+/**
+ * A skinned model ready to animate and draw
+ * 
+ * Skeleton, mesh and animation are extracted from the glTF model in one
+ * pass into a single arena sized from its accessor counts, then the model
+ * (parsed JSON plus every decoded buffer) is freed. Only runtime data stays
+ * resident, which adds up with hundreds of assets in a scene.
+ * 
+ * With `_halfKeys` the animator keeps its rotation keys as halves, and the
+ * arena is sized for those, see SkeletalAnimator::loadFromTinyGLTF.
+ * 
+ * The asset must not move, the animator points at its skeleton.
+ * */
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+#include <tiny_gltf.h>
+
+#include "skeletal/skeleton.hpp"
+#include "skeletal/mesh.hpp"
+#include "skeletal/animator.hpp"
+
+struct SkinnedAsset {
+    std::pmr::monotonic_buffer_resource arena; // first, so it outlives what it holds
+    size_t arenaBytes;
+    Skeleton skel;
+    BoneWeightedMesh mesh;
+    SkeletalAnimator anim;
+
+    explicit SkinnedAsset(size_t _arenaBytes);
+    SkinnedAsset(const SkinnedAsset&) = delete;
+    SkinnedAsset& operator=(const SkinnedAsset&) = delete;
+};
+
+// Loads everything from `_model` and frees it, it is left empty. Returns
+// nullptr with `_err` set if any of the three loaders fails.
+std::unique_ptr<SkinnedAsset> loadSkinnedAsset(
+    tinygltf::Model&& _model,
+    std::string& _warn,
+    std::string& _err,
+    bool _halfKeys = false
+);
+
+// Parses the .gltf/.glb file at `_path`, the model never outlives the call.
+std::unique_ptr<SkinnedAsset> loadSkinnedAsset(
+    const std::string& _path,
+    std::string& _warn,
+    std::string& _err,
+    bool _halfKeys = false
+);
@@ -0,0 +1,46 @@
+/**
+ * Layered clip blending
+ * 
+ * A pose is built from a stack of layers, bottom to top. Each layer samples
+ * one clip of a SkeletalAnimator at its own time and blends it over the
+ * layers below:
+ *   override  slerp from the pose below towards the clip by `weight`, a
+ *             crossfade between two clips is clip A at 1 then clip B at t
+ *   additive  the clip's rotation relative to its first key, scaled by
+ *             `weight` and applied on top of the pose below
+ * A layer with a JointMask only touches, and only samples, the joints in the
+ * mask: upper body from one clip and lower body from another costs one
+ * sample per joint, not two.
+ * */
+#pragma once
+
+#include <vector>
+
+#include "skeletal/skeleton.hpp"
+
+struct JointMask {
+    std::vector<int> joints;             // joints in the mask, parents first
+    std::vector<unsigned char> included; // per joint, 1 if in the mask
+
+    bool contains(int _joint) const { return included[_joint] != 0; }
+
+    // `_root` and every joint below it
+    static JointMask subtree(const Skeleton& _skel, int _root);
+    // exactly the joints listed
+    static JointMask fromJoints(const Skeleton& _skel, const std::vector<int>& _joints);
+    // every joint of `_skel` that is not in this mask
+    JointMask inverted(const Skeleton& _skel) const;
+};
+
+enum class BlendMode {
+    Override,
+    Additive
+};
+
+struct AnimationLayer {
+    int clip = 0;
+    float time = 0.0f;      // seconds, clamped to the clip
+    float weight = 1.0f;    // 0 leaves the pose below untouched
+    BlendMode mode = BlendMode::Override;
+    const JointMask* mask = nullptr; // every joint when null
+};
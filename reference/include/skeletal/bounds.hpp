@@ -0,0 +1,32 @@
+/**
+ * Bounding volumes of skinned meshes
+ * 
+ * Every joint gets a bind-space sphere around the vertices it influences.
+ * A skinned vertex is a weighted average of the vertex moved by each of its
+ * joints, so it stays inside the union of the joint spheres moved by the
+ * same palette. Enclosing that union gives a tight bound of the posed mesh
+ * without touching a single vertex at runtime.
+ * */
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "skeletal/mesh.hpp"
+
+struct SkinnedBounds {
+    // bind-space sphere per joint (center in xyz, radius in w),
+    // negative radius for joints influencing no vertex
+    std::vector<glm::vec4> jointSpheres;
+
+    // vertices count for a joint once their weight exceeds `_minWeight`
+    void build(const BoneWeightedMesh& _mesh, size_t _boneCount, float _minWeight = 0.0f);
+
+    // model-space sphere enclosing the mesh skinned with `_palette`
+    glm::vec4 computeBound(const glm::mat4* _palette) const;
+};
+
+// moves a sphere (center in xyz, radius in w) by an affine transform,
+// scaling the radius by the largest axis scale
+glm::vec4 transformSphere(const glm::mat4& _transform, const glm::vec4& _sphere);
@@ -0,0 +1,150 @@
+/**
+ * Animation state machines with blend trees, evaluated for many instances
+ *
+ * A graph is described as data (AnimationGraphDesc, from JSON or code):
+ * named float parameters, states that each play a blend tree, and
+ * transitions that cross-fade to another state when a parameter passes a
+ * threshold. A blend tree node either plays a clip or blends its children
+ * by a parameter, child i playing fully at thresholds[i] and neighbours
+ * crossfading in between.
+ *
+ * AnimationGraph compiles that into flat arrays: every tree node of every
+ * state, parents before children, children next to each other. Evaluation
+ * then walks the program once for all instances sharing the graph, each
+ * step (a transition, a node's weights, a clip's samples) runs over every
+ * instance before the next one, on plain per-instance arrays.
+ *
+ * Clips inside a state are phase-synchronized: the state keeps a normalized
+ * phase and each clip plays at phase * its duration, so a walk and a run of
+ * different lengths stay in step while blending.
+ *
+ *   {
+ *     "parameters": ["speed"],
+ *     "initial": "idle",
+ *     "states": [
+ *       { "name": "idle", "tree": { "clip": "Idle" } },
+ *       { "name": "move", "tree": { "parameter": "speed", "thresholds": [0, 1],
+ *                                   "children": [{ "clip": "Walk" }, { "clip": "Run" }] } }
+ *     ],
+ *     "transitions": [
+ *       { "from": "idle", "to": "move", "parameter": "speed", "above": 0.1, "duration": 0.3 },
+ *       { "from": "move", "to": "idle", "parameter": "speed", "below": 0.1, "duration": 0.3 }
+ *     ]
+ *   }
+ *
+ * Clips are referred to by name or by index, "from": "*" matches any state.
+ * */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "skeletal/animator.hpp"
+
+struct BlendTreeNodeDesc {
+    std::string clip;                  // leaf: clip name or index
+    std::string parameter;             // blend: the parameter driving it
+    std::vector<float> thresholds;     // blend: increasing, one per child
+    std::vector<BlendTreeNodeDesc> children;
+};
+
+struct AnimationStateDesc {
+    std::string name;
+    BlendTreeNodeDesc tree;
+    float speed = 1.0f;
+    bool loop = true;
+};
+
+struct AnimationTransitionDesc {
+    std::string from;                  // state name, "*" for any state
+    std::string to;
+    std::string parameter;
+    bool above = true;                 // fires when the parameter is above (or below) threshold
+    float threshold = 0.0f;
+    float duration = 0.2f;             // cross-fade, seconds
+};
+
+struct AnimationGraphDesc {
+    std::vector<std::string> parameters;
+    std::vector<AnimationStateDesc> states;
+    std::vector<AnimationTransitionDesc> transitions;
+    std::string initial;               // first state when empty
+
+    bool loadFromJson(const std::string& _path, std::string& _err);
+};
+
+// per-instance runtime state, structure of arrays
+struct AnimationGraphInstances {
+    size_t count = 0;
+    size_t parameterCount = 0;
+    std::vector<float> parameters;     // instance-major, parameterCount per instance
+    std::vector<int> state;
+    std::vector<float> phase;          // normalized, 0 to 1
+    std::vector<int> previousState;    // state faded out, -1 when not fading
+    std::vector<float> previousPhase;
+    std::vector<float> fade;           // seconds into the cross-fade
+    std::vector<float> fadeDuration;
+
+    float& parameter(size_t _instance, int _parameter) { return parameters[_instance * parameterCount + _parameter]; }
+};
+
+class AnimationGraph
+{
+private:
+    struct Node {
+        int state;
+        int clip = -1;                 // leaf when >= 0
+        int parameter = -1;            // blend node
+        int firstChild = 0;
+        int childCount = 0;
+        int firstThreshold = 0;        // into `thresholds`, childCount of them
+    };
+
+    struct State {
+        int root;                      // node index
+        int firstLeaf, leafCount;      // into `leaves`
+        float speed;
+        bool loop;
+    };
+
+    struct Transition {
+        int from;                      // -1 for any state
+        int to;
+        int parameter;
+        bool above;
+        float threshold;
+        float duration;
+    };
+
+    const SkeletalAnimator* animator = nullptr;
+    std::vector<std::string> parameterNames;
+    std::vector<Node> nodes;           // parents first, siblings contiguous
+    std::vector<float> thresholds;
+    std::vector<int> leaves;           // leaf nodes, grouped by state
+    std::vector<State> states;
+    std::vector<Transition> transitions;
+    int initialState = 0;
+
+    // appends the tree of state `_state`, breadth first
+    bool compileTree(const BlendTreeNodeDesc& _root, int _state, std::string& _err);
+    void fireTransitions(AnimationGraphInstances& _instances) const;
+    // weight of every node for every instance, node-major, each active state's root at 1
+    void computeNodeWeights(const AnimationGraphInstances& _instances, float* _weights) const;
+
+public:
+    bool compile(const AnimationGraphDesc& _desc, const SkeletalAnimator* _animator, std::string& _err);
+
+    int findParameter(const std::string& _name) const;
+    size_t getParameterCount() const { return parameterNames.size(); }
+    size_t getStateCount() const { return states.size(); }
+
+    // `_count` instances in the initial state, every parameter at 0
+    void initInstances(AnimationGraphInstances& _instances, size_t _count) const;
+
+    // Fires transitions, advances every instance by `_dt` seconds and writes
+    // boneCount skinning matrices per instance to `_palettes`.
+    void evaluate(AnimationGraphInstances& _instances, float _dt, glm::mat4* _palettes) const;
+};
@@ -0,0 +1,66 @@
+/**
+ * Half-precision (IEEE 754 binary16) storage for animation data
+ *
+ * Bone palettes and rotation keys can be kept as halves: a palette matrix
+ * takes 32 bytes instead of 64, a rotation key 8 instead of 16. Shaders
+ * unpack palettes with unpackHalf2x16, see res/shader/mesh_half.vs and its
+ * crowd and batch counterparts.
+ *
+ * Conversion uses F16C, 8 values per instruction, on x86 CPUs that have it
+ * (checked once at startup, no build flags needed) and rounds to nearest
+ * even in scalar code otherwise, with the same results.
+ *
+ * A half keeps about 3 significant digits. That is plenty for rotations and
+ * for the translations of a rig near the origin, less so for joints far from
+ * it: a translation of 100 moves by up to 0.03. Validate with the error
+ * reported by measurePaletteError and SkeletalAnimator::compressKeyframes.
+ * */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// column-major like glm::mat4
+struct HalfMat4 {
+    uint16_t m[16];
+};
+
+// x, y, z, w
+struct HalfQuat {
+    uint16_t xyzw[4];
+};
+
+uint16_t floatToHalf(float _value);
+float halfToFloat(uint16_t _half);
+
+// `_count` values at once, F16C when available
+void packHalves(const float* _values, uint16_t* _halves, size_t _count);
+void unpackHalves(const uint16_t* _halves, float* _values, size_t _count);
+
+void packPalette(const glm::mat4* _palette, size_t _count, HalfMat4* _halves);
+HalfQuat packQuat(const glm::quat& _rotation);
+glm::quat unpackQuat(const HalfQuat& _rotation);
+
+// difference between values and their halves
+struct HalfPrecisionError {
+    float maxAbsolute = 0.0f;   // largest difference of a component
+    float meanAbsolute = 0.0f;
+    float maxAngle = 0.0f;      // rotations only, largest angle to the original in radians
+    size_t count = 0;           // components compared
+
+    void add(float _value, float _stored);
+    void addRotation(const glm::quat& _rotation, const glm::quat& _stored);
+    // meanAbsolute is a running sum until then
+    void finish();
+};
+
+// what packPalette loses on `_palette`, the translation column gives the
+// position error directly
+HalfPrecisionError measurePaletteError(const glm::mat4* _palette, size_t _count);
+
+// "max 0.0012, mean 0.0001, max angle 0.02 deg over 1024 values"
+std::ostream& operator<<(std::ostream& _out, const HalfPrecisionError& _error);
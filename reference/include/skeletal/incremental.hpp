@@ -0,0 +1,62 @@
+/**
+ * Incremental forward kinematics
+ *
+ * IncrementalPose keeps the local rotations, globals and skinning matrices
+ * of one instance between frames and only recomputes what moved: joints
+ * whose local rotation changed, and everything below them. Tracks that are
+ * constant in the clip (see AnimationClip::constant) are not even sampled,
+ * joints left alone by a layer mask compare equal and stay clean, and
+ * joints frozen by a skeleton LOD level only follow their proxy.
+ *
+ * A rig where a handful of joints move pays for those joints and their
+ * subtrees instead of the whole skeleton. A change of clip or LOD level
+ * falls back to one full solve.
+ *
+ *   IncrementalPose pose(&animator);
+ *   pose.update(clip, time);                     // sample + solve
+ *   upload(pose.getPalette(), boneCount);
+ * */
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "skeletal/animator.hpp"
+
+class IncrementalPose
+{
+private:
+    const SkeletalAnimator* animator = nullptr;
+    std::vector<glm::quat> rotations;   // local rotation of every joint, as last solved
+    std::vector<glm::mat4> globals;
+    std::vector<glm::mat4> palette;
+    std::vector<unsigned char> dirty;   // per joint, local rotation changed since the last solve
+    std::vector<int> moving;            // evaluated joints whose track in `clip` is not constant
+    int clip = -1;                      // clip `moving` was built for
+    const SkeletonLODLevel* lod = nullptr;
+    bool valid = false;                 // false until the first full solve
+    size_t dirtyCount = 0;
+
+    // marks every joint dirty after a change of clip, LOD level or invalidate()
+    bool beginFull(const SkeletonLODLevel* _lod);
+    void solve(const SkeletonLODLevel* _lod);
+
+public:
+    explicit IncrementalPose(const SkeletalAnimator* _animator);
+
+    // forces a full solve on the next update
+    void invalidate() { valid = false; }
+
+    // samples `_clip` at `_time`, only its moving tracks after the first call
+    void update(int _clip, float _time, const SkeletonLODLevel* _lod = nullptr);
+    // from local rotations computed elsewhere (layers, a graph), one per joint,
+    // joints whose rotation is unchanged stay clean
+    void update(const glm::quat* _rotations, const SkeletonLODLevel* _lod = nullptr);
+
+    const glm::mat4* getGlobals() const { return globals.data(); }
+    const glm::mat4* getPalette() const { return palette.data(); }
+    // evaluated joints recomputed by the last update
+    size_t getDirtyCount() const { return dirtyCount; }
+};
@@ -0,0 +1,101 @@
+/**
+ * Level of detail for skeletal animation
+ * 
+ * AnimationLODScheduler lowers the update rate of characters that are small
+ * on screen: every frame, every 2nd, 4th or 8th frame. Instances sharing an
+ * interval get evenly spread phases so the work per frame stays flat, and
+ * between updates the caller keeps using the previous palette.
+ * 
+ * SkeletonLOD reduces the joints that are evaluated at all. Each level keeps
+ * a subset of the skeleton that is closed under parents; a skipped joint is
+ * rigidly attached to its nearest kept ancestor, so its skinning matrix is
+ * that ancestor's and the mesh can be re-weighted onto the kept joints.
+ * */
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera/fpc.hpp"
+#include "skeletal/skeleton.hpp"
+#include "skeletal/mesh.hpp"
+
+// level l updates every 2^l frames
+#define ANIMATION_LOD_LEVELS 4
+
+// radius of a world-space sphere (center in xyz, radius in w) projected on
+// screen, as a fraction of half the screen height
+float projectedSphereSize(const glm::vec4& _worldSphere, const FirstPersonCamera::FrameConstants& _frame);
+
+class AnimationLODScheduler
+{
+private:
+    // projected size (see projectedSphereSize) below which level l+1 is used
+    float thresholds[ANIMATION_LOD_LEVELS - 1] = { 0.15f, 0.06f, 0.025f };
+    // a level is only left once the size moved this far past its threshold
+    float hysteresis = 0.1f;
+
+    std::vector<unsigned char> levels;
+    std::vector<unsigned char> phases;
+    unsigned int levelCounters[ANIMATION_LOD_LEVELS] = {};
+    unsigned int frame = 0;
+
+    int chooseLevel(size_t _instance, float _screenSize) const;
+
+public:
+    explicit AnimationLODScheduler(size_t _instanceCount = 0);
+
+    void resize(size_t _instanceCount);
+    void setThresholds(float _level1, float _level2, float _level3);
+
+    // advances the frame counter, call once per frame before shouldUpdate
+    void beginFrame() { ++frame; }
+
+    // Picks the instance's level from the projected size of its world-space
+    // bounding sphere (center in xyz, radius in w) and tells whether its
+    // pose is due this frame. Changing level always triggers an update.
+    bool shouldUpdate(size_t _instance, const glm::vec4& _worldSphere, const FirstPersonCamera::FrameConstants& _frame);
+
+    int getLevel(size_t _instance) const { return levels[_instance]; }
+    unsigned int getInterval(size_t _instance) const { return 1u << levels[_instance]; }
+};
+
+struct SkeletonLODLevel {
+    std::vector<unsigned char> evaluated; // per joint, 1 if sampled and run through FK
+    std::vector<int> evalOrder;           // evaluated joints only, parents first
+    std::vector<int> skipped;             // the others, parents first
+    std::vector<int> proxy;               // nearest evaluated joint up the hierarchy, itself when evaluated
+    std::vector<glm::mat4> proxyOffset;   // bind transform of a skipped joint relative to its proxy
+};
+
+class SkeletonLOD
+{
+private:
+    const Skeleton* skeleton = nullptr;
+    std::vector<SkeletonLODLevel> levels;
+
+    // adds a level from a per-joint keep flag, completed with every ancestor and root
+    int addLevel(std::vector<unsigned char> _keep);
+
+public:
+    // level 0 always evaluates the full skeleton
+    explicit SkeletonLOD(const Skeleton* _skel);
+
+    // The generators below append a level and return its index. Levels are
+    // expected from finest to coarsest but nothing enforces it.
+
+    // keeps the listed joints
+    int addLevelFromJoints(const std::vector<int>& _joints);
+    // keeps joints whose bone, from the parent's bind position, is at least `_minLength` long
+    int addLevelFromBoneLength(float _minLength);
+    // keeps joints carrying at least `_minShare` of the mesh's total skin weight
+    int addLevelFromInfluence(const BoneWeightedMesh& _mesh, float _minShare);
+
+    size_t getLevelCount() const { return this->levels.size(); }
+    const SkeletonLODLevel& getLevel(int _level) const { return this->levels[_level]; }
+
+    // copy of `_src` whose influences only reference joints evaluated at `_level`,
+    // weights of influences that collapse onto the same joint are merged
+    void reweightMesh(int _level, const BoneWeightedMesh& _src, BoneWeightedMesh& _dst) const;
+};
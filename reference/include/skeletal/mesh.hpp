@@ -8,25 +8,33 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
 #include <string>
 
 #include <glm/glm.hpp>
 #include <tiny_gltf.h>
 
 struct BoneWeightedMesh {
-    std::vector<unsigned int> indices;
+    std::pmr::vector<unsigned int> indices;
 
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> uvs;
+    std::pmr::vector<glm::vec3> positions;
+    std::pmr::vector<glm::vec3> normals;
+    std::pmr::vector<glm::vec2> uvs;
 
     bool hasNormals;
     bool hasUVs;
 
-    std::vector<glm::uvec4> influences;
-    std::vector<glm::vec4> weights;
+    std::pmr::vector<glm::uvec4> influences;
+    std::pmr::vector<glm::vec4> weights;
 
 public:
+    // Vertex data is allocated from `_resource`, which must outlive the mesh.
+    // Copies of the mesh go back to the default resource.
+    explicit BoneWeightedMesh(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+
+    // bytes loadFromTinyGLTF allocates for `mdl`, from the accessor counts
+    static size_t estimateLoadBytes(const tinygltf::Model& mdl);
+
     /** 
      * Some reference code to load data with tinygltf
      * Check the gltf 2.0 specification if you feel confused
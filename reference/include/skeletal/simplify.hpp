@@ -0,0 +1,51 @@
+/**
+ * Level of detail chain for skinned meshes
+ * 
+ * Triangles are removed by half-edge collapses ordered by quadric error
+ * (Garland & Heckbert). A collapse moves one vertex onto a neighbour, so
+ * every kept vertex keeps its exact attributes and skin weights. To keep the
+ * deformation right the cost also grows with how differently the two
+ * vertices are skinned: collapsing across a joint boundary would drag the
+ * surface with the wrong bone.
+ * */
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "skeletal/mesh.hpp"
+
+// Simplifies `_src` down to about `_targetTriangles` triangles into `_dst`.
+// `_skinWeight` scales the skinning term of the error: a collapse between
+// vertices with disjoint influences costs `_skinWeight` times the squared
+// edge length on top of its geometric error. Vertices sharing a position
+// with another vertex (uv or normal seams) never move, so seams stay closed.
+// Returns false when no triangle could be removed.
+bool simplifySkinnedMesh(
+    const BoneWeightedMesh& _src,
+    size_t _targetTriangles,
+    float _skinWeight,
+    BoneWeightedMesh& _dst
+);
+
+struct MeshLODChain {
+    // level 0 is the source mesh, every next one has fewer triangles
+    std::vector<BoneWeightedMesh> levels;
+    // projected size (see projectedSphereSize) below which level l+1 is used
+    std::vector<float> thresholds;
+
+    // Fills up to `_levelCount` levels, each keeping `_ratio` of the previous
+    // level's triangles. Generation stops early once a level can not be
+    // reduced any further. The first switch happens at `_firstThreshold`,
+    // every next one at half the previous size.
+    void build(
+        const BoneWeightedMesh& _mesh,
+        int _levelCount,
+        float _ratio = 0.5f,
+        float _skinWeight = 1.0f,
+        float _firstThreshold = 0.2f
+    );
+
+    int selectLevel(float _screenSize) const;
+};
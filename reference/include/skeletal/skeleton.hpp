@@ -5,6 +5,8 @@
 #pragma once
 
 #include <vector>
+#include <memory_resource>
+#include <string>
 #include <unordered_map>
 #include <iostream>
 
@@ -23,30 +25,58 @@ struct Joint {
     // Some properties to save..?
     ///////////
     /****************************************My Code***************************************************/
-    std::string name;
-    glm::vec3 basePosition;
-    glm::quat baseQuaternion;
+    std::pmr::string name;
+    glm::vec3 basePosition = {0.0f, 0.0f, 0.0f};
+    glm::quat baseQuaternion = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // identity, glm is wxyz
     glm::vec3 baseScale = {1.0f, 1.0f, 1.0f};
     glm::mat4 invBindMatrix = glm::mat4(1.0f);
     glm::vec3 position = {0,0,0};
 
-    std::vector<int> Children;
+    std::pmr::vector<int> Children;
     int Parent = -1;
     int numChildren;
     
     /****************************************My Code end***************************************************/
+
+    // allocator-aware, so the name and children live in the skeleton's memory resource
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    Joint() = default;
+    explicit Joint(const allocator_type& _alloc) : name(_alloc), Children(_alloc) {}
+    Joint(const Joint& _other, const allocator_type& _alloc);
+    Joint(Joint&& _other, const allocator_type& _alloc);
+    Joint(const Joint&) = default;
+    Joint(Joint&&) = default;
+    Joint& operator=(const Joint&) = default;
+    Joint& operator=(Joint&&) = default;
 };
 
 class Skeleton {
 private:
     // Joint* root;
     int root; //using index num to represent root.
-    std::vector<Joint> joints;
+    std::pmr::vector<Joint> joints;
+    std::pmr::vector<int> evalOrder; // joint indices, parents always before their children
+    std::pmr::vector<glm::mat4> inverseBindMatrices; // inverse of each joint's global bind transform
 
 public:
+    // Everything loaded is allocated from `_resource`, which must outlive the
+    // skeleton. See estimateLoadBytes() to size an arena for it.
+    explicit Skeleton(std::pmr::memory_resource* _resource = std::pmr::get_default_resource());
+
+    // bytes loadFromTinyGLTF allocates for `mdl`, from the accessor counts
+    static size_t estimateLoadBytes(const tinygltf::Model& mdl);
+
     size_t getBoneNum() const { return this->joints.size(); }
     const auto& getJoints() const { return joints; }
     const auto& getRoot() const { return root; }
+    const auto& getEvalOrder() const { return evalOrder; }
+    const auto& getInverseBindMatrices() const { return inverseBindMatrices; }
+
+    // local bind transform of a joint: translation * rotation * scale
+    glm::mat4 getBindLocalTransform(int j_id) const;
+    // the same with an animated local rotation
+    glm::mat4 getLocalTransform(int j_id, const glm::quat& rotation) const;
 
     /** 
      * Some reference code to load data with tinygltf
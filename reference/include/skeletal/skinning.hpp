@@ -0,0 +1,26 @@
+/**
+ * Linear blend skinning on the CPU
+ * 
+ * The same sum res/shader/mesh.vs computes: every vertex is the weighted sum
+ * of itself moved by each influencing joint. For offline work (baking,
+ * benchmarks, tests), rendering skins on the GPU.
+ * */
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "skeletal/mesh.hpp"
+
+// Skins every vertex of `_mesh` with `_palette` (`_boneCount` matrices) into
+// `_positions`, and the normals into `_normals` when it is not null and the
+// mesh has normals. A vertex referencing a joint outside the palette keeps
+// its bind position, like the shader does.
+void skinVertices(
+    const BoneWeightedMesh& _mesh,
+    const glm::mat4* _palette,
+    size_t _boneCount,
+    glm::vec3* _positions,
+    glm::vec3* _normals = nullptr
+);
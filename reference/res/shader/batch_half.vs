@@ -0,0 +1,67 @@
+// batch.vs with a half-float palette, see "pipeline/batch.hpp"
+// Per-draw data is indexed by gl_DrawID, per-instance data by gl_InstanceID
+
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 3) in uvec4 influences;
+layout(location = 4) in vec4 weights;
+
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec4 camPos;
+};
+
+struct DrawData {
+    uint firstInstance;
+    uint paletteBase;
+    uint boneCount;
+    uint padding;
+};
+
+layout(std430, binding = 4) readonly buffer Draws {
+    DrawData draws[];
+};
+
+layout(std430, binding = 5) readonly buffer Models {
+    mat4 models[];
+};
+
+// each matrix is 16 halves in two uvec4 of packed pairs, column-major
+layout(std430, binding = 6) readonly buffer Palettes {
+    uvec4 halfPalettes[];
+};
+
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_ID gl_DrawIDARB
+#else
+// set per draw by SkinnedMeshBatcher when gl_DrawID is unavailable
+uniform int drawIndex;
+#define DRAW_ID drawIndex
+#endif
+
+mat4 boneMatrix(uint bone)
+{
+    uvec4 a = halfPalettes[2u * bone];
+    uvec4 b = halfPalettes[2u * bone + 1u];
+    return mat4(vec4(unpackHalf2x16(a.x), unpackHalf2x16(a.y)),
+                vec4(unpackHalf2x16(a.z), unpackHalf2x16(a.w)),
+                vec4(unpackHalf2x16(b.x), unpackHalf2x16(b.y)),
+                vec4(unpackHalf2x16(b.z), unpackHalf2x16(b.w)));
+}
+
+void main()
+{
+    DrawData draw = draws[DRAW_ID];
+    uint paletteBase = draw.paletteBase + uint(gl_InstanceID) * draw.boneCount;
+
+    mat4 skin = mat4(0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        skin += boneMatrix(paletteBase + influences[i]) * weights[i];
+    }
+    gl_Position = projection * view * models[draw.firstInstance + uint(gl_InstanceID)] * skin * vec4(pos, 1.0);
+}
@@ -0,0 +1,37 @@
+// Instanced skinning for crowds, see "pipeline/crowd.hpp"
+// Per-instance data lives in shader storage buffers indexed by gl_InstanceID
+
+#version 430 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 3) in uvec4 influences;
+layout(location = 4) in vec4 weights;
+
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec4 camPos;
+};
+
+layout(std430, binding = 1) readonly buffer InstanceModels {
+    mat4 models[];
+};
+
+// boneCount matrices per instance
+layout(std430, binding = 2) readonly buffer InstancePalettes {
+    mat4 palettes[];
+};
+
+uniform int boneCount;
+
+void main()
+{
+    int paletteBase = gl_InstanceID * boneCount;
+    mat4 skin = mat4(0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        skin += palettes[paletteBase + int(influences[i])] * weights[i];
+    }
+    gl_Position = projection * view * models[gl_InstanceID] * skin * vec4(pos, 1.0);
+}
@@ -0,0 +1,48 @@
+// crowd.vs with a half-float palette, see "pipeline/crowd.hpp"
+// Per-instance data lives in shader storage buffers indexed by gl_InstanceID
+
+#version 430 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 3) in uvec4 influences;
+layout(location = 4) in vec4 weights;
+
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec4 camPos;
+};
+
+layout(std430, binding = 1) readonly buffer InstanceModels {
+    mat4 models[];
+};
+
+// boneCount matrices per instance, each 16 halves in two uvec4 of packed
+// pairs, column-major
+layout(std430, binding = 2) readonly buffer InstancePalettes {
+    uvec4 halfPalettes[];
+};
+
+uniform int boneCount;
+
+mat4 boneMatrix(uint bone)
+{
+    uvec4 a = halfPalettes[2u * bone];
+    uvec4 b = halfPalettes[2u * bone + 1u];
+    return mat4(vec4(unpackHalf2x16(a.x), unpackHalf2x16(a.y)),
+                vec4(unpackHalf2x16(a.z), unpackHalf2x16(a.w)),
+                vec4(unpackHalf2x16(b.x), unpackHalf2x16(b.y)),
+                vec4(unpackHalf2x16(b.z), unpackHalf2x16(b.w)));
+}
+
+void main()
+{
+    int paletteBase = gl_InstanceID * boneCount;
+    mat4 skin = mat4(0.0);
+    for (int i = 0; i < 4; i++)
+    {
+        skin += boneMatrix(uint(paletteBase) + influences[i]) * weights[i];
+    }
+    gl_Position = projection * view * models[gl_InstanceID] * skin * vec4(pos, 1.0);
+}
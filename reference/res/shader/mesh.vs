@@ -6,13 +6,18 @@ layout(location = 2) in vec2 uvs;
 layout(location = 3) in ivec4 influences; 
 layout(location = 4) in vec4 weights;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec4 camPos;
+};
 uniform mat4 model;
 
-const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
-uniform mat4 finalBonesMatrices[MAX_BONES];
+// streamed per frame by WireframeMeshPipeline
+layout(std430, binding = 3) readonly buffer BonePalette {
+    mat4 finalBonesMatrices[];
+};
 
 out vec2 TexCoords;
 
@@ -23,7 +28,7 @@ void main()
     {
         if(influences[i] == -1) 
             continue;
-        if(influences[i] >=MAX_BONES) 
+        if(influences[i] >= finalBonesMatrices.length()) 
         {
             totalPosition = vec4(pos,1.0f);
             break;
@@ -0,0 +1,54 @@
+#version 430 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 uvs;
+layout(location = 3) in ivec4 influences; 
+layout(location = 4) in vec4 weights;
+
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec4 camPos;
+};
+uniform mat4 model;
+
+const int MAX_BONE_INFLUENCE = 4;
+// mesh.vs with a half-float palette, streamed per frame by WireframeMeshPipeline:
+// each matrix is 16 halves, column-major, two uvec4 of packed pairs
+layout(std430, binding = 3) readonly buffer BonePalette {
+    uvec4 halfBonesMatrices[];
+};
+
+out vec2 TexCoords;
+
+mat4 boneMatrix(int bone)
+{
+    uvec4 a = halfBonesMatrices[2 * bone];
+    uvec4 b = halfBonesMatrices[2 * bone + 1];
+    return mat4(vec4(unpackHalf2x16(a.x), unpackHalf2x16(a.y)),
+                vec4(unpackHalf2x16(a.z), unpackHalf2x16(a.w)),
+                vec4(unpackHalf2x16(b.x), unpackHalf2x16(b.y)),
+                vec4(unpackHalf2x16(b.z), unpackHalf2x16(b.w)));
+}
+
+void main()
+{
+    vec4 totalPosition = vec4(0.0f);
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(influences[i] == -1) 
+            continue;
+        if(influences[i] >= halfBonesMatrices.length() / 2) 
+        {
+            totalPosition = vec4(pos,1.0f);
+            break;
+        }
+        vec4 localPosition = boneMatrix(influences[i]) * vec4(pos,1.0f);
+        totalPosition += localPosition * weights[i];
+   }
+	
+    mat4 viewModel = view * model;
+    gl_Position =  projection * viewModel * totalPosition;
+	TexCoords = uvs;
+}
@@ -7,8 +7,11 @@
 //You may need some other layouts for rendering an animated mesh
 layout (location = 0) in vec3 pos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 projection;
+    mat4 view;
+    vec4 camPos;
+};
 
 void main() {
     gl_Position = projection * view * vec4(pos,1.0);
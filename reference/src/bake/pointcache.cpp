@@ -0,0 +1,357 @@
+#include "bake/pointcache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // the header is written field by field, never as a padded struct
+    template<typename T>
+    void append(std::vector<unsigned char>& _out, const T& _value) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&_value);
+        _out.insert(_out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void appendVarint(std::vector<unsigned char>& _out, uint32_t _value) {
+        while (_value >= 0x80) {
+            _out.push_back(static_cast<unsigned char>(_value | 0x80));
+            _value >>= 7;
+        }
+        _out.push_back(static_cast<unsigned char>(_value));
+    }
+
+    uint32_t zigzag(int32_t _value) {
+        return (static_cast<uint32_t>(_value) << 1) ^ static_cast<uint32_t>(_value >> 31);
+    }
+
+    int32_t unzigzag(uint32_t _value) {
+        return static_cast<int32_t>(_value >> 1) ^ -static_cast<int32_t>(_value & 1);
+    }
+
+    template<typename T>
+    T consume(const unsigned char*& _in) {
+        T value;
+        std::memcpy(&value, _in, sizeof(T));
+        _in += sizeof(T);
+        return value;
+    }
+
+    // magic, version, vertex and frame count, fps, key frame interval, box
+    const size_t headerSize = 4 + 4 * 5 + 4 * 6;
+    // type and payload size
+    const size_t frameHeaderSize = 1 + 4;
+
+    // offset of the frame count in the header, patched on close
+    const long frameCountOffset = 4 + 4 + 4;
+}
+
+PointCacheWriter::
+~PointCacheWriter() {
+    std::string err;
+    this->close(err);
+}
+
+bool PointCacheWriter::
+open(const std::string& _path, size_t _vertexCount, float _fps, 
+     const glm::vec3& _boxMin, const glm::vec3& _boxMax, 
+     uint32_t _keyframeInterval, std::string& err) {
+    this->file = std::fopen(_path.c_str(), "wb");
+    if (!this->file) {
+        err = "Failed to create " + _path;
+        return false;
+    }
+
+    this->vertexCount = static_cast<uint32_t>(_vertexCount);
+    this->frameCount = 0;
+    this->keyframeInterval = std::max<uint32_t>(1, _keyframeInterval);
+    this->boxMin = _boxMin;
+    glm::vec3 extent = glm::max(_boxMax - _boxMin, glm::vec3(1e-6f));
+    this->boxScale = glm::vec3(65535.0f) / extent;
+    this->maxError = 0.0f;
+    this->previous.assign(3 * _vertexCount, 0);
+    this->current.assign(3 * _vertexCount, 0);
+    // worst case frame: type, size and a 3-byte varint per component
+    for (auto& buffer : this->buffers)
+        buffer.reserve(5 + 9 * _vertexCount);
+
+    std::vector<unsigned char> header;
+    header.insert(header.end(), { 'S', 'P', 'C', '1' });
+    append<uint32_t>(header, POINT_CACHE_VERSION);
+    append<uint32_t>(header, this->vertexCount);
+    append<uint32_t>(header, 0); // frame count, patched on close
+    append<float>(header, _fps);
+    append<uint32_t>(header, this->keyframeInterval);
+    for (int i = 0; i < 3; ++i)
+        append<float>(header, _boxMin[i]);
+    for (int i = 0; i < 3; ++i)
+        append<float>(header, _boxMax[i]);
+    if (std::fwrite(header.data(), 1, header.size(), this->file) != header.size()) {
+        err = "Failed to write " + _path;
+        std::fclose(this->file);
+        this->file = nullptr;
+        return false;
+    }
+    this->bytesWritten = header.size();
+
+    this->pending = false;
+    this->stopping = false;
+    this->ioFailed = false;
+    this->fill = 0;
+    this->writer = std::thread(&PointCacheWriter::writerLoop, this);
+    return true;
+}
+
+void PointCacheWriter::
+encodeFrame(const glm::vec3* _positions, std::vector<unsigned char>& _out) {
+    for (uint32_t v = 0; v < this->vertexCount; ++v) {
+        glm::vec3 q = glm::clamp((_positions[v] - this->boxMin) * this->boxScale, glm::vec3(0.0f), glm::vec3(65535.0f));
+        glm::vec3 rounded(std::round(q.x), std::round(q.y), std::round(q.z));
+        for (int i = 0; i < 3; ++i)
+            this->current[3 * v + i] = static_cast<uint16_t>(rounded[i]);
+        this->maxError = std::max(this->maxError, glm::length((rounded - q) / this->boxScale));
+    }
+
+    bool key = this->frameCount % this->keyframeInterval == 0;
+    _out.clear();
+    _out.push_back(key ? POINT_CACHE_KEY_FRAME : POINT_CACHE_DELTA_FRAME);
+    append<uint32_t>(_out, 0); // payload size, filled below
+    size_t payloadStart = _out.size();
+    if (key) {
+        for (uint16_t value : this->current)
+            append<uint16_t>(_out, value);
+    } else {
+        for (size_t i = 0; i < this->current.size(); ++i)
+            appendVarint(_out, zigzag(int32_t(this->current[i]) - int32_t(this->previous[i])));
+    }
+    uint32_t payloadSize = static_cast<uint32_t>(_out.size() - payloadStart);
+    std::memcpy(&_out[1], &payloadSize, sizeof(payloadSize));
+
+    std::swap(this->previous, this->current);
+}
+
+void PointCacheWriter::
+writeFrame(const glm::vec3* _positions) {
+    if (!this->file)
+        return;
+    // only the caller touches `buffers[fill]`, the writer owns the other one while pending
+    this->encodeFrame(_positions, this->buffers[this->fill]);
+    ++this->frameCount;
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cond.wait(lock, [this] { return !this->pending; });
+    this->bytesWritten += this->buffers[this->fill].size();
+    this->fill = 1 - this->fill;
+    this->pending = true;
+    this->cond.notify_all();
+}
+
+void PointCacheWriter::
+writerLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->cond.wait(lock, [this] { return this->pending || this->stopping; });
+        if (!this->pending)
+            return;
+
+        // the frame just handed over is the one the caller is not filling
+        std::vector<unsigned char>& buffer = this->buffers[1 - this->fill];
+        lock.unlock();
+        bool ok = std::fwrite(buffer.data(), 1, buffer.size(), this->file) == buffer.size();
+        lock.lock();
+
+        this->ioFailed = this->ioFailed || !ok;
+        this->pending = false;
+        this->cond.notify_all();
+    }
+}
+
+bool PointCacheWriter::
+close(std::string& err) {
+    if (!this->file)
+        return true;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+        this->cond.notify_all();
+    }
+    this->writer.join();
+
+    bool ok = !this->ioFailed;
+    ok = ok && std::fseek(this->file, frameCountOffset, SEEK_SET) == 0;
+    ok = ok && std::fwrite(&this->frameCount, sizeof(this->frameCount), 1, this->file) == 1;
+    ok = std::fclose(this->file) == 0 && ok;
+    this->file = nullptr;
+    if (!ok)
+        err = "Failed to write the point cache.";
+    return ok;
+}
+
+PointCacheReader::
+~PointCacheReader() {
+    this->close();
+}
+
+bool PointCacheReader::
+open(const std::string& _path, std::string& err) {
+    this->close();
+    this->file = std::fopen(_path.c_str(), "rb");
+    if (!this->file) {
+        err = "Failed to open " + _path;
+        return false;
+    }
+
+    unsigned char header[headerSize];
+    if (std::fread(header, 1, headerSize, this->file) != headerSize || std::memcmp(header, "SPC1", 4) != 0) {
+        err = _path + " is not a point cache.";
+        this->close();
+        return false;
+    }
+    const unsigned char* in = header + 4;
+    uint32_t version = consume<uint32_t>(in);
+    if (version != POINT_CACHE_VERSION) {
+        err = "Unsupported point cache version " + std::to_string(version) + ".";
+        this->close();
+        return false;
+    }
+    this->vertexCount = consume<uint32_t>(in);
+    this->frameCount = consume<uint32_t>(in);
+    this->fps = consume<float>(in);
+    this->keyframeInterval = std::max<uint32_t>(1, consume<uint32_t>(in));
+    glm::vec3 boxMax;
+    for (int i = 0; i < 3; ++i)
+        this->boxMin[i] = consume<float>(in);
+    for (int i = 0; i < 3; ++i)
+        boxMax[i] = consume<float>(in);
+    glm::vec3 extent = glm::max(boxMax - this->boxMin, glm::vec3(1e-6f));
+    this->boxScale = glm::vec3(65535.0f) / extent;
+
+    // frames only know their own size, walk them once to be able to seek
+    std::fseek(this->file, 0, SEEK_END);
+    long fileSize = std::ftell(this->file);
+    long offset = static_cast<long>(headerSize);
+    this->frameOffsets.resize(this->frameCount);
+    for (uint32_t f = 0; f < this->frameCount; ++f) {
+        unsigned char frameHeader[frameHeaderSize];
+        long frameSize = -1;
+        if (std::fseek(this->file, offset, SEEK_SET) == 0 
+            && std::fread(frameHeader, 1, frameHeaderSize, this->file) == frameHeaderSize) {
+            const unsigned char* in = frameHeader + 1;
+            frameSize = long(frameHeaderSize) + long(consume<uint32_t>(in));
+        }
+        if (frameSize < 0 || offset + frameSize > fileSize) {
+            err = _path + " is cut short at frame " + std::to_string(f) + ".";
+            this->close();
+            return false;
+        }
+        this->frameOffsets[f] = offset;
+        offset += frameSize;
+    }
+    if (offset != fileSize) {
+        // the writer patches the frame count last
+        err = _path + " was not closed by its writer.";
+        this->close();
+        return false;
+    }
+
+    this->values.assign(3 * size_t(this->vertexCount), 0);
+    this->nextFrame = 0;
+    std::fseek(this->file, static_cast<long>(headerSize), SEEK_SET);
+    return true;
+}
+
+void PointCacheReader::
+close() {
+    if (this->file) {
+        std::fclose(this->file);
+        this->file = nullptr;
+    }
+    this->frameOffsets.clear();
+    this->frameCount = 0;
+    this->nextFrame = 0;
+}
+
+bool PointCacheReader::
+decodeFrame(std::string& err) {
+    unsigned char frameHeader[frameHeaderSize];
+    if (std::fread(frameHeader, 1, frameHeaderSize, this->file) != frameHeaderSize) {
+        err = "Failed to read frame " + std::to_string(this->nextFrame) + ".";
+        return false;
+    }
+    const unsigned char* in = frameHeader;
+    uint8_t type = consume<uint8_t>(in);
+    uint32_t size = consume<uint32_t>(in);
+    this->payload.resize(size);
+    if (std::fread(this->payload.data(), 1, size, this->file) != size) {
+        err = "Failed to read frame " + std::to_string(this->nextFrame) + ".";
+        return false;
+    }
+
+    bool ok = false;
+    if (type == POINT_CACHE_KEY_FRAME) {
+        ok = size == this->values.size() * sizeof(uint16_t);
+        if (ok)
+            std::memcpy(this->values.data(), this->payload.data(), size);
+    } else if (type == POINT_CACHE_DELTA_FRAME) {
+        // relative to `values`, which the frame before left there
+        const unsigned char* cursor = this->payload.data();
+        const unsigned char* end = cursor + size;
+        ok = true;
+        for (size_t i = 0; i < this->values.size() && ok; ++i) {
+            uint32_t value = 0;
+            int shift = 0;
+            do {
+                ok = cursor < end && shift < 32;
+                if (ok)
+                    value |= uint32_t(*cursor & 0x7f) << shift;
+                shift += 7;
+            } while (ok && *cursor++ & 0x80);
+            if (ok)
+                this->values[i] = static_cast<uint16_t>(this->values[i] + unzigzag(value));
+        }
+        ok = ok && cursor == end;
+    }
+    if (!ok) {
+        err = "Frame " + std::to_string(this->nextFrame) + " is corrupt.";
+        return false;
+    }
+    ++this->nextFrame;
+    return true;
+}
+
+bool PointCacheReader::
+readFrame(glm::vec3* _positions, std::string& err) {
+    if (!this->file || this->nextFrame >= this->frameCount) {
+        err = "No frame left to read.";
+        return false;
+    }
+    if (!this->decodeFrame(err))
+        return false;
+
+    for (uint32_t v = 0; v < this->vertexCount; ++v) {
+        glm::vec3 q(this->values[3 * v], this->values[3 * v + 1], this->values[3 * v + 2]);
+        _positions[v] = this->boxMin + q / this->boxScale;
+    }
+    return true;
+}
+
+bool PointCacheReader::
+seek(uint32_t _frame, std::string& err) {
+    if (!this->file || _frame >= this->frameCount) {
+        err = "Frame " + std::to_string(_frame) + " is out of range.";
+        return false;
+    }
+
+    // deltas need every frame since the last key frame, unless we are
+    // already on the way there
+    uint32_t key = _frame - _frame % this->keyframeInterval;
+    if (this->nextFrame <= key || this->nextFrame > _frame) {
+        this->nextFrame = key;
+        std::fseek(this->file, this->frameOffsets[key], SEEK_SET);
+    }
+    while (this->nextFrame < _frame) {
+        if (!this->decodeFrame(err))
+            return false;
+    }
+    return true;
+}
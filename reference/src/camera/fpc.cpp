@@ -38,6 +38,25 @@ applyToShader(Shader *_shader) {
     applyCameraPos(_shader);
 }
 
+void FirstPersonCamera::
+updateFrameConstants() {
+    this->frameConstants.projection = glm::perspective<float>(this->fov, this->aspect, this->nearClipDist, this->farClipDist);
+    this->frameConstants.view = glm::lookAt<float>(this->cameraPos, this->cameraPos + this->cameraForward, this->cameraLocalUp);
+    this->frameConstants.camPos = glm::vec4(this->cameraPos, 1.0f);
+
+    // created lazily since the camera may be constructed before the GL context
+    if (this->frameUBO == 0) {
+        glGenBuffers(1, &this->frameUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, this->frameUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), nullptr, GL_DYNAMIC_DRAW);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, this->frameUBO);
+    }
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &this->frameConstants);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, this->frameUBO);
+}
+
 void FirstPersonCamera::
 applyProjection(Shader *_shader) {
     glm::mat4 projection;
@@ -104,6 +123,14 @@ lookLeft(float _angle) {
     // this->printInfo();
 }
 
+void FirstPersonCamera::
+lookAt(const glm::vec3& _position, const glm::vec3& _target) {
+    this->cameraPos = _position;
+    this->cameraForward = glm::normalize(_target - _position);
+    this->cameraRight = glm::normalize(glm::cross(this->cameraForward, this->cameraGlobalUp));
+    this->cameraLocalUp = glm::cross(this->cameraRight, this->cameraForward);
+}
+
 void FirstPersonCamera::
 lookUp(float _angle) {
     glm::mat3 rotation = glm::rotate(glm::mat4(1.0f), _angle, this->cameraRight);
@@ -0,0 +1,86 @@
+#include "camera/frustum.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE
+#endif
+
+Frustum::
+Frustum() {
+    // everything is inside
+    for (auto& plane : this->planes)
+        plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::
+Frustum(const glm::mat4& _viewProjection) {
+    // Gribb & Hartmann: the planes are sums/differences of the matrix rows
+    const glm::mat4& m = _viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    this->planes[0] = row3 + row0;
+    this->planes[1] = row3 - row0;
+    this->planes[2] = row3 + row1;
+    this->planes[3] = row3 - row1;
+    this->planes[4] = row3 + row2;
+    this->planes[5] = row3 - row2;
+
+    // normalized so that the plane distance compares against a radius
+    for (auto& plane : this->planes)
+        plane = plane / glm::length(glm::vec3(plane));
+}
+
+bool Frustum::
+intersectsSphere(const glm::vec4& _sphere) const {
+    for (const auto& plane : this->planes) {
+        float dist = plane.x * _sphere.x + plane.y * _sphere.y + plane.z * _sphere.z + plane.w;
+        if (dist < -_sphere.w)
+            return false;
+    }
+    return true;
+}
+
+void Frustum::
+cullSpheres(const glm::vec4* _spheres, size_t _count, unsigned char* _visible) const {
+    size_t i = 0;
+#ifdef FRUSTUM_USE_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; ++p) {
+        planeX[p] = _mm_set1_ps(this->planes[p].x);
+        planeY[p] = _mm_set1_ps(this->planes[p].y);
+        planeZ[p] = _mm_set1_ps(this->planes[p].z);
+        planeW[p] = _mm_set1_ps(this->planes[p].w);
+    }
+
+    for (; i + 4 <= _count; i += 4) {
+        // four AoS spheres into SoA registers: x, y, z, radius
+        __m128 x = _mm_loadu_ps(&_spheres[i + 0].x);
+        __m128 y = _mm_loadu_ps(&_spheres[i + 1].x);
+        __m128 z = _mm_loadu_ps(&_spheres[i + 2].x);
+        __m128 r = _mm_loadu_ps(&_spheres[i + 3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+        __m128 inside = _mm_cmpeq_ps(r, r); // all ones unless the radius is NaN
+        for (int p = 0; p < 6; ++p) {
+            __m128 dist = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p])
+            );
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        _visible[i + 0] = (mask >> 0) & 1;
+        _visible[i + 1] = (mask >> 1) & 1;
+        _visible[i + 2] = (mask >> 2) & 1;
+        _visible[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+    for (; i < _count; ++i) {
+        _visible[i] = this->intersectsSphere(_spheres[i]) ? 1 : 0;
+    }
+}
@@ -0,0 +1,248 @@
+#include "gltf/synthetic.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace {
+    const float pi = 3.14159265f;
+
+    // appends `_bytes` to the model's only buffer, 4-byte aligned, and returns the new view
+    int addBufferView(tinygltf::Model& _gltf, const void* _data, size_t _bytes, int _target) {
+        std::vector<unsigned char>& data = _gltf.buffers[0].data;
+        data.resize((data.size() + 3) & ~size_t(3));
+
+        tinygltf::BufferView view;
+        view.buffer = 0;
+        view.byteOffset = data.size();
+        view.byteLength = _bytes;
+        view.target = _target;
+        data.insert(data.end(), static_cast<const unsigned char*>(_data), static_cast<const unsigned char*>(_data) + _bytes);
+
+        _gltf.bufferViews.push_back(view);
+        return static_cast<int>(_gltf.bufferViews.size()) - 1;
+    }
+
+    int addAccessor(tinygltf::Model& _gltf, int _view, int _componentType, size_t _count, int _type) {
+        tinygltf::Accessor accessor;
+        accessor.bufferView = _view;
+        accessor.componentType = _componentType;
+        accessor.count = _count;
+        accessor.type = _type;
+        _gltf.accessors.push_back(accessor);
+        return static_cast<int>(_gltf.accessors.size()) - 1;
+    }
+
+    template<typename T>
+    int addData(tinygltf::Model& _gltf, const std::vector<T>& _data, int _componentType, int _type, int _target = 0) {
+        size_t components = sizeof(T) / tinygltf::GetComponentSizeInBytes(_componentType);
+        size_t count = _data.size() * components / tinygltf::GetNumComponentsInType(_type);
+        int view = addBufferView(_gltf, _data.data(), _data.size() * sizeof(T), _target);
+        return addAccessor(_gltf, view, _componentType, count, _type);
+    }
+}
+
+void tinygltf_buildSyntheticModel(const SyntheticModelDesc& desc, tinygltf::Model& gltf)
+{
+    const int jointCount = std::max(1, desc.jointCount);
+    const int branching = std::max(1, desc.branching);
+    const int vertexCount = std::max(3, desc.vertexCount);
+    const int influences = std::clamp(desc.influences, 1, 4);
+    const int keyframeCount = std::max(2, static_cast<int>(std::ceil(desc.duration * desc.keysPerSecond)) + 1);
+    const int maxDepth = desc.maxDepth > 0 ? desc.maxDepth : jointCount;
+
+    gltf = tinygltf::Model();
+    gltf.asset.version = "2.0";
+    gltf.asset.generator = "skeletal-animation synthetic";
+    gltf.buffers.resize(1);
+
+    // joint tree in breadth-first order, siblings fanned out along x
+    std::vector<int> parents(jointCount, -1);
+    std::vector<int> depths(jointCount, 0);
+    std::vector<glm::vec3> bindPositions(jointCount, glm::vec3(0.0f));
+    gltf.nodes.resize(jointCount + 1);
+    gltf.nodes[0].name = "joint0";
+    gltf.nodes[0].translation = { 0.0, 0.0, 0.0 };
+    size_t open = 0;             // next joint still taking children, breadth first
+    std::vector<int> parentPool; // joints above the depth limit, for the overflow
+    size_t overflow = 0;
+    for (int j = 1; j < jointCount; ++j) {
+        int candidate = j - 1;
+        if (depths[candidate] < maxDepth)
+            parentPool.push_back(candidate);
+        while (open < static_cast<size_t>(j) && (depths[open] >= maxDepth || 
+               static_cast<int>(gltf.nodes[open].children.size()) >= branching))
+            ++open;
+        int parent = open < static_cast<size_t>(j) ? static_cast<int>(open) : parentPool[overflow++ % parentPool.size()];
+
+        int sibling = static_cast<int>(gltf.nodes[parent].children.size());
+        glm::vec3 offset(0.05f * (sibling % branching - 0.5f * (branching - 1)), 0.1f, 0.02f * (sibling / branching));
+        parents[j] = parent;
+        depths[j] = depths[parent] + 1;
+        bindPositions[j] = bindPositions[parent] + offset;
+
+        tinygltf::Node& node = gltf.nodes[j];
+        node.name = "joint" + std::to_string(j);
+        node.translation = { offset.x, offset.y, offset.z };
+        gltf.nodes[parent].children.push_back(j);
+    }
+
+    // skin, the inverse binds of an unrotated tree are pure translations
+    std::vector<glm::mat4> inverseBinds(jointCount, glm::mat4(1.0f));
+    for (int j = 0; j < jointCount; ++j)
+        inverseBinds[j][3] = glm::vec4(-bindPositions[j], 1.0f);
+    tinygltf::Skin skin;
+    skin.skeleton = 0;
+    for (int j = 0; j < jointCount; ++j)
+        skin.joints.push_back(j);
+    skin.inverseBindMatrices = addData(gltf, inverseBinds, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_MAT4);
+    gltf.skins.push_back(skin);
+
+    // a ring of vertices around each joint's bind position, stitched into one strip
+    std::vector<glm::vec3> positions(vertexCount), normals(vertexCount);
+    std::vector<glm::vec4> weights(vertexCount, glm::vec4(0.0f));
+    std::vector<glm::u16vec4> joints(vertexCount, glm::u16vec4(0));
+    glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+    for (int v = 0; v < vertexCount; ++v) {
+        int j = static_cast<int>(static_cast<long long>(v) * jointCount / vertexCount);
+        float angle = 2.0f * pi * (v % 8) / 8.0f;
+        normals[v] = glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+        positions[v] = bindPositions[j] + 0.02f * normals[v];
+        boxMin = glm::min(boxMin, positions[v]);
+        boxMax = glm::max(boxMax, positions[v]);
+
+        // the joint and its ancestors, halving the weight each step up
+        float total = 0.0f;
+        for (int k = 0, joint = j; k < influences && joint != -1; ++k, joint = parents[joint]) {
+            joints[v][k] = static_cast<unsigned short>(joint);
+            weights[v][k] = 1.0f / float(1 << k);
+            total += weights[v][k];
+        }
+        weights[v] /= total;
+    }
+
+    std::vector<unsigned int> indices;
+    indices.reserve(3 * (vertexCount - 2));
+    for (int v = 0; v + 2 < vertexCount; ++v) {
+        indices.push_back(v);
+        indices.push_back(v % 2 ? v + 2 : v + 1);
+        indices.push_back(v % 2 ? v + 1 : v + 2);
+    }
+
+    // smallest component types that fit, like exporters do
+    tinygltf::Primitive primitive;
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    primitive.attributes["POSITION"] = addData(gltf, positions, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, TINYGLTF_TARGET_ARRAY_BUFFER);
+    gltf.accessors[primitive.attributes["POSITION"]].minValues = { boxMin.x, boxMin.y, boxMin.z };
+    gltf.accessors[primitive.attributes["POSITION"]].maxValues = { boxMax.x, boxMax.y, boxMax.z };
+    primitive.attributes["NORMAL"] = addData(gltf, normals, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3, TINYGLTF_TARGET_ARRAY_BUFFER);
+    primitive.attributes["WEIGHTS_0"] = addData(gltf, weights, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4, TINYGLTF_TARGET_ARRAY_BUFFER);
+    if (jointCount <= 256) {
+        std::vector<glm::u8vec4> joints8(joints.begin(), joints.end());
+        primitive.attributes["JOINTS_0"] = addData(gltf, joints8, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, TINYGLTF_TYPE_VEC4, TINYGLTF_TARGET_ARRAY_BUFFER);
+    } else {
+        primitive.attributes["JOINTS_0"] = addData(gltf, joints, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_VEC4, TINYGLTF_TARGET_ARRAY_BUFFER);
+    }
+    if (vertexCount <= 65536) {
+        std::vector<unsigned short> indices16(indices.begin(), indices.end());
+        primitive.indices = addData(gltf, indices16, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+    } else {
+        primitive.indices = addData(gltf, indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+    }
+
+    tinygltf::Mesh mesh;
+    mesh.name = "synthetic";
+    mesh.primitives.push_back(primitive);
+    gltf.meshes.push_back(mesh);
+
+    tinygltf::Node& meshNode = gltf.nodes[jointCount];
+    meshNode.name = "mesh";
+    meshNode.mesh = 0;
+    meshNode.skin = 0;
+
+    tinygltf::Scene scene;
+    scene.nodes = { 0, jointCount };
+    gltf.scenes.push_back(scene);
+    gltf.defaultScene = 0;
+
+    // every joint moves with its own phase, all samplers share one time accessor
+    std::vector<float> times(keyframeCount);
+    for (int k = 0; k < keyframeCount; ++k)
+        times[k] = desc.duration * k / (keyframeCount - 1);
+    int timeAccessor = addData(gltf, times, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_SCALAR);
+    gltf.accessors[timeAccessor].minValues = { times.front() };
+    gltf.accessors[timeAccessor].maxValues = { times.back() };
+
+    const bool cubic = desc.interpolation == "CUBICSPLINE";
+    tinygltf::Animation animation;
+    animation.name = "synthetic";
+    std::vector<glm::vec4> values(keyframeCount);
+    std::vector<glm::vec4> output;
+    auto addChannel = [&](int joint, const char* path, int type) {
+        // cubic splines store in-tangent, value, out-tangent per key;
+        // central differences, per second like glTF expects
+        output.clear();
+        for (int k = 0; k < keyframeCount; ++k) {
+            if (cubic) {
+                int next = std::min(k + 1, keyframeCount - 1), previous = std::max(k - 1, 0);
+                glm::vec4 tangent = (values[next] - values[previous]) / (times[next] - times[previous]);
+                output.push_back(tangent);
+                output.push_back(values[k]);
+                output.push_back(tangent);
+            } else {
+                output.push_back(values[k]);
+            }
+        }
+
+        tinygltf::AnimationSampler sampler;
+        sampler.input = timeAccessor;
+        if (type == TINYGLTF_TYPE_VEC3) {
+            std::vector<glm::vec3> output3(output.size());
+            for (size_t i = 0; i < output.size(); ++i)
+                output3[i] = glm::vec3(output[i]);
+            sampler.output = addData(gltf, output3, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3);
+        } else {
+            sampler.output = addData(gltf, output, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4);
+        }
+        sampler.interpolation = desc.interpolation;
+        animation.samplers.push_back(sampler);
+
+        tinygltf::AnimationChannel channel;
+        channel.sampler = static_cast<int>(animation.samplers.size()) - 1;
+        channel.target_node = joint;
+        channel.target_path = path;
+        animation.channels.push_back(channel);
+    };
+
+    // joint j moves when j * fraction crosses an integer, so movers are evenly spaced
+    const float fraction = std::clamp(desc.animatedFraction, 0.0f, 1.0f);
+    for (int j = 0; j < jointCount; ++j) {
+        const std::vector<double>& base = gltf.nodes[j].translation;
+        const float amount = std::floor((j + 1) * fraction) > std::floor(j * fraction) ? 1.0f : 0.0f;
+        if (desc.channels & SYNTHETIC_CHANNEL_TRANSLATION) {
+            for (int k = 0; k < keyframeCount; ++k) {
+                float bob = amount * 0.01f * std::sin(2.0f * pi * k / (keyframeCount - 1) + 1.3f * j);
+                values[k] = glm::vec4(float(base[0]), float(base[1]) + bob, float(base[2]), 0.0f);
+            }
+            addChannel(j, "translation", TINYGLTF_TYPE_VEC3);
+        }
+        if (desc.channels & SYNTHETIC_CHANNEL_ROTATION) {
+            for (int k = 0; k < keyframeCount; ++k) {
+                float angle = amount * 0.3f * std::sin(2.0f * pi * k / (keyframeCount - 1) + 0.7f * j);
+                values[k] = glm::vec4(0.0f, 0.0f, std::sin(0.5f * angle), std::cos(0.5f * angle)); // xyzw
+            }
+            addChannel(j, "rotation", TINYGLTF_TYPE_VEC4);
+        }
+        if (desc.channels & SYNTHETIC_CHANNEL_SCALE) {
+            for (int k = 0; k < keyframeCount; ++k) {
+                float pulse = 1.0f + amount * 0.05f * std::sin(2.0f * pi * k / (keyframeCount - 1) + 0.4f * j);
+                values[k] = glm::vec4(pulse, pulse, pulse, 0.0f);
+            }
+            addChannel(j, "scale", TINYGLTF_TYPE_VEC3);
+        }
+    }
+    gltf.animations.push_back(animation);
+}
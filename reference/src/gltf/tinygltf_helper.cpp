@@ -1,6 +1,7 @@
 #define TINYGLTF_IMPLEMENTATION
 
 #include "gltf/tinygltf_helper.h"
+#include "profile/profiler.hpp"
 
 tinygltf_DataGetter tinygltf_buildDataGetter(const tinygltf::Model& gltf, int accIndex)
 {
@@ -30,6 +31,7 @@ int tinygltf_findAccessor(
 }
 
 bool tinygltf_parsefile(const std::string& filename, tinygltf::Model& gltf) {
+    PROFILE_ZONE("load: parse gltf");
     auto loader = std::make_unique<tinygltf::TinyGLTF>();
 
     std::string err, warn;
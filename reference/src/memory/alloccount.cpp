@@ -0,0 +1,43 @@
+#include "memory/alloccount.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    thread_local size_t threadAllocations = 0;
+    std::atomic<size_t> totalAllocations{0};
+}
+
+size_t AllocationCounter::
+getThreadCount() {
+    return threadAllocations;
+}
+
+size_t AllocationCounter::
+getTotalCount() {
+    return totalAllocations.load(std::memory_order_relaxed);
+}
+
+// the standard library's nothrow and sized forms forward to these, so four
+// are enough. Over-aligned new (alignas above 16) is not counted
+
+void* operator new(size_t _size) {
+    ++threadAllocations;
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(_size ? _size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t _size) {
+    return ::operator new(_size);
+}
+
+void operator delete(void* _p) noexcept {
+    std::free(_p);
+}
+
+void operator delete[](void* _p) noexcept {
+    std::free(_p);
+}
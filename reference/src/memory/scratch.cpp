@@ -0,0 +1,55 @@
+#include "memory/scratch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+// first offset at or after `_offset` whose address is aligned to `_alignment`
+static size_t
+alignOffset(const std::byte* _base, size_t _offset, size_t _alignment) {
+    auto address = reinterpret_cast<uintptr_t>(_base) + _offset;
+    return _offset + (_alignment - address % _alignment) % _alignment;
+}
+
+FrameScratch& FrameScratch::
+get() {
+    thread_local FrameScratch scratch;
+    return scratch;
+}
+
+void* FrameScratch::
+allocate(size_t _bytes, size_t _alignment) {
+    // first block from the current one on with room left
+    for (; this->block < this->blocks.size(); ++this->block, this->offset = 0) {
+        Block& current = this->blocks[this->block];
+        size_t start = alignOffset(current.data.get(), this->offset, _alignment);
+        if (start + _bytes <= current.size) {
+            this->offset = start + _bytes;
+            return current.data.get() + start;
+        }
+    }
+
+    // out of blocks, only while warming up: grow geometrically
+    size_t size = this->blocks.empty() ? FRAME_SCRATCH_BLOCK_SIZE : 2 * this->blocks.back().size;
+    size = std::max(size, _bytes + _alignment);
+    this->blocks.push_back({ std::make_unique<std::byte[]>(size), size });
+    this->block = this->blocks.size() - 1;
+
+    Block& current = this->blocks.back();
+    size_t start = alignOffset(current.data.get(), 0, _alignment);
+    this->offset = start + _bytes;
+    return current.data.get() + start;
+}
+
+void FrameScratch::
+rewind(const Marker& _marker) {
+    this->block = _marker.block;
+    this->offset = _marker.offset;
+}
+
+size_t FrameScratch::
+getCapacity() const {
+    size_t capacity = 0;
+    for (const Block& block : this->blocks)
+        capacity += block.size;
+    return capacity;
+}
@@ -0,0 +1,57 @@
+#include "memory/usage.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+#if defined(_WIN32)
+    #define NOMINMAX
+    #define PSAPI_VERSION 2 // GetProcessMemoryInfo from kernel32, no psapi.lib
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(__linux__)
+    // read from /proc/self/status
+#else
+    #include <sys/resource.h>
+#endif
+
+MemoryUsage getMemoryUsage() {
+    MemoryUsage usage;
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        usage.resident = counters.WorkingSetSize;
+        usage.peak = counters.PeakWorkingSetSize;
+    }
+#elif defined(__linux__)
+    // "VmRSS:     1234 kB", VmHWM is the peak
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    size_t kilobytes;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> kilobytes)
+            usage.resident = kilobytes * 1024;
+        else if (key == "VmHWM:" && status >> kilobytes)
+            usage.peak = kilobytes * 1024;
+        status.ignore(256, '\n');
+    }
+#else
+    // only the peak, in bytes on macOS
+    struct rusage self;
+    if (getrusage(RUSAGE_SELF, &self) == 0)
+        usage.peak = static_cast<size_t>(self.ru_maxrss);
+#endif
+    return usage;
+}
+
+std::ostream& operator<<(std::ostream& _out, const MemoryUsage& _usage) {
+    auto flags = _out.flags();
+    auto precision = _out.precision();
+    _out << std::fixed << std::setprecision(1)
+         << "resident " << _usage.resident / (1024.0 * 1024.0) << " MiB, "
+         << "peak " << _usage.peak / (1024.0 * 1024.0) << " MiB";
+    _out.flags(flags);
+    _out.precision(precision);
+    return _out;
+}
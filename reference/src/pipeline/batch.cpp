@@ -0,0 +1,173 @@
+#include "pipeline/batch.hpp"
+
+#include <algorithm>
+
+SkinnedMeshBatcher::
+SkinnedMeshBatcher(
+    Shader* _shader, 
+    FirstPersonCamera* _camera,
+    bool _halfPalette
+) : commandStream(GL_DRAW_INDIRECT_BUFFER, 64 * sizeof(DrawCommand)),
+    drawStream(GL_SHADER_STORAGE_BUFFER, 64 * sizeof(DrawData)),
+    modelStream(GL_SHADER_STORAGE_BUFFER, 64 * sizeof(glm::mat4)),
+    paletteStream(GL_SHADER_STORAGE_BUFFER, 64 * sizeof(glm::mat4)) {
+    this->shader = _shader;
+    this->camera = _camera;
+    this->halfPalette = _halfPalette;
+    this->drawIndexLocation = _shader->getUniformLocation("drawIndex");
+
+    // batch.vs only declares the drawIndex uniform when it compiled without
+    // GL_ARB_shader_draw_parameters, so the shader itself tells which path it took
+    this->hasDrawID = this->drawIndexLocation < 0;
+}
+
+int SkinnedMeshBatcher::
+addMesh(const BoneWeightedMesh* _mesh, size_t _boneCount) {
+    MeshSlot slot;
+    slot.firstIndex = static_cast<GLuint>(this->indexArena.size());
+    slot.indexCount = static_cast<GLuint>(_mesh->indices.size());
+    slot.baseVertex = static_cast<GLint>(this->vertexArena.size());
+    slot.boneCount = _boneCount;
+
+    // indices stay relative to the mesh, the command's baseVertex offsets them
+    this->indexArena.insert(this->indexArena.end(), _mesh->indices.begin(), _mesh->indices.end());
+    for (size_t i = 0; i < _mesh->positions.size(); ++i) {
+        VertexData vertex;
+        vertex.position = _mesh->positions[i];
+        vertex.normal = _mesh->hasNormals ? _mesh->normals[i] : glm::vec3(0.0f, 1.0f, 0.0f);
+        vertex.influences = _mesh->influences[i];
+        vertex.weights = _mesh->weights[i];
+        this->vertexArena.push_back(vertex);
+    }
+
+    this->meshes.push_back(std::move(slot));
+    return static_cast<int>(this->meshes.size()) - 1;
+}
+
+void SkinnedMeshBatcher::
+build() {
+    glGenVertexArrays(1, &this->glo.VAO);
+    glGenBuffers(1, &this->glo.VBO);
+    glGenBuffers(1, &this->glo.EBO);
+
+    glBindVertexArray(this->glo.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->glo.VBO);
+    allocateStaticStorage(GL_ARRAY_BUFFER, this->vertexArena.size() * sizeof(VertexData), this->vertexArena.data());
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glo.EBO); // Bound to VAO
+    allocateStaticStorage(GL_ELEMENT_ARRAY_BUFFER, this->indexArena.size() * sizeof(unsigned int), this->indexArena.data());
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, normal));
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 4, GL_UNSIGNED_INT, sizeof(VertexData), (void*)offsetof(VertexData, influences));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, weights));
+
+    glBindVertexArray(0);
+
+    // the GPU owns the geometry now
+    std::vector<VertexData>().swap(this->vertexArena);
+    std::vector<unsigned int>().swap(this->indexArena);
+}
+
+void SkinnedMeshBatcher::
+submit(int _meshId, const glm::mat4& _model, const glm::mat4* _palette) {
+    MeshSlot& slot = this->meshes[_meshId];
+    slot.models.push_back(_model);
+    slot.palettes.push_back(_palette);
+}
+
+void SkinnedMeshBatcher::
+record(RenderQueue& queue) {
+    // one command per mesh with instances, instances of a mesh are contiguous
+    this->commands.clear();
+    this->drawData.clear();
+    this->models.clear();
+    size_t paletteCount = 0;
+    for (MeshSlot& slot : this->meshes) {
+        if (slot.models.empty())
+            continue;
+
+        DrawCommand command;
+        command.count = slot.indexCount;
+        command.instanceCount = static_cast<GLuint>(slot.models.size());
+        command.firstIndex = slot.firstIndex;
+        command.baseVertex = slot.baseVertex;
+        command.baseInstance = 0;
+        this->commands.push_back(command);
+
+        DrawData data;
+        data.firstInstance = static_cast<GLuint>(this->models.size());
+        data.paletteBase = static_cast<GLuint>(paletteCount);
+        data.boneCount = static_cast<GLuint>(slot.boneCount);
+        data.padding = 0;
+        this->drawData.push_back(data);
+
+        this->models.insert(this->models.end(), slot.models.begin(), slot.models.end());
+        paletteCount += slot.palettes.size() * slot.boneCount;
+        slot.models.clear();
+    }
+    if (this->commands.empty())
+        return;
+
+    GLintptr commandOffset = this->commandStream.write(this->commands.data(), this->commands.size() * sizeof(DrawCommand));
+    GLintptr drawOffset = this->drawStream.write(this->drawData.data(), this->drawData.size() * sizeof(DrawData));
+    GLintptr modelOffset = this->modelStream.write(this->models.data(), this->models.size() * sizeof(glm::mat4));
+
+    // the palettes are copied once, from the caller straight into the mapped
+    // stream in command order (packed when halves); staged only on the
+    // glBufferSubData fallback
+    size_t paletteBytes = paletteCount * (this->halfPalette ? sizeof(HalfMat4) : sizeof(glm::mat4));
+    GLintptr paletteOffset = 0;
+    void* palettes = this->paletteStream.reserve(paletteBytes, paletteOffset);
+    bool staged = palettes == nullptr;
+    if (staged && this->halfPalette) {
+        this->halfPalettes.resize(paletteCount);
+        palettes = this->halfPalettes.data();
+    } else if (staged) {
+        this->palettes.resize(paletteCount);
+        palettes = this->palettes.data();
+    }
+    size_t written = 0;
+    for (MeshSlot& slot : this->meshes) {
+        for (const glm::mat4* palette : slot.palettes) {
+            if (this->halfPalette)
+                packPalette(palette, slot.boneCount, static_cast<HalfMat4*>(palettes) + written);
+            else
+                std::copy(palette, palette + slot.boneCount, static_cast<glm::mat4*>(palettes) + written);
+            written += slot.boneCount;
+        }
+        slot.palettes.clear();
+    }
+    if (staged)
+        paletteOffset = this->paletteStream.write(palettes, paletteBytes);
+
+    // camera matrices come from the FrameConstants block
+    DrawPacket packet;
+    packet.kind = DrawPacket::MultiElementsIndirect;
+    packet.program = this->shader->ID;
+    packet.vao = this->glo.VAO;
+    packet.polygonMode = GL_LINE; // we want wire-frame mode
+    packet.primitive = GL_TRIANGLES;
+    packet.addStorage(BATCH_DRAW_BINDING, this->drawStream.getBuffer(), 
+                      drawOffset, this->drawData.size() * sizeof(DrawData));
+    packet.addStorage(BATCH_MODEL_BINDING, this->modelStream.getBuffer(), 
+                      modelOffset, this->models.size() * sizeof(glm::mat4));
+    packet.addStorage(BATCH_PALETTE_BINDING, this->paletteStream.getBuffer(), 
+                      paletteOffset, paletteBytes);
+    packet.count = static_cast<GLsizei>(this->commands.size());
+    packet.indirectBuffer = this->commandStream.getBuffer();
+    packet.indirectOffset = commandOffset;
+    packet.indirectStride = sizeof(DrawCommand);
+    // the whole frame in one call, unless gl_DrawID is missing
+    packet.drawIndexLocation = this->hasDrawID ? -1 : this->drawIndexLocation;
+    queue.record(packet);
+
+    queue.addStream(&this->commandStream);
+    queue.addStream(&this->drawStream);
+    queue.addStream(&this->modelStream);
+    queue.addStream(&this->paletteStream);
+}
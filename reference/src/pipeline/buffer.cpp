@@ -0,0 +1,176 @@
+#include "pipeline/buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "profile/profiler.hpp"
+
+namespace {
+    bool hasBufferStorage()
+    {
+        return GLAD_GL_VERSION_4_4;
+    }
+
+    size_t offsetAlignment(GLenum target)
+    {
+        GLint alignment = 16;
+        if (target == GL_SHADER_STORAGE_BUFFER)
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        else if (target == GL_UNIFORM_BUFFER)
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        return std::max<size_t>(alignment, 16);
+    }
+
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void allocateStaticStorage(GLenum _target, GLsizeiptr _size, const void* _data)
+{
+    if (hasBufferStorage())
+        glBufferStorage(_target, _size, _data, 0);
+    else
+        glBufferData(_target, _size, _data, GL_STATIC_DRAW);
+}
+
+StreamingBuffer::
+StreamingBuffer(GLenum _target, size_t _regionSize) {
+    this->target = _target;
+    this->alignment = offsetAlignment(_target);
+    this->allocate(std::max<size_t>(_regionSize, this->alignment));
+}
+
+StreamingBuffer::
+~StreamingBuffer() {
+    if (!this->retired.empty())
+        glDeleteBuffers(static_cast<GLsizei>(this->retired.size()), this->retired.data());
+    this->release();
+}
+
+void StreamingBuffer::
+allocate(size_t _regionSize) {
+    this->regionSize = alignUp(_regionSize, this->alignment);
+    size_t totalSize = this->regionSize * STREAMING_BUFFER_REGIONS;
+
+    glGenBuffers(1, &this->buffer);
+    glBindBuffer(this->target, this->buffer);
+    if (hasBufferStorage()) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(this->target, totalSize, nullptr, flags);
+        this->mapped = static_cast<unsigned char*>(glMapBufferRange(this->target, 0, totalSize, flags));
+    } else {
+        glBufferData(this->target, totalSize, nullptr, GL_STREAM_DRAW);
+        this->mapped = nullptr;
+    }
+    glBindBuffer(this->target, 0);
+
+    this->region = 0;
+    this->head = 0;
+}
+
+void StreamingBuffer::
+release() {
+    for (int i = 0; i < STREAMING_BUFFER_REGIONS; ++i) {
+        if (this->fences[i]) {
+            glDeleteSync(this->fences[i]);
+            this->fences[i] = nullptr;
+        }
+    }
+    if (this->buffer) {
+        if (this->mapped) {
+            glBindBuffer(this->target, this->buffer);
+            glUnmapBuffer(this->target);
+            glBindBuffer(this->target, 0);
+            this->mapped = nullptr;
+        }
+        glDeleteBuffers(1, &this->buffer);
+        this->buffer = 0;
+    }
+}
+
+void StreamingBuffer::
+waitFence(int _region) {
+    GLsync& fence = this->fences[_region];
+    if (!fence)
+        return;
+
+    // usually signaled long ago, we are two frames ahead at most
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamingBuffer::
+grow(size_t _needed) {
+    // offsets handed out earlier this frame still point into the current
+    // buffer, so it is only retired here and deleted by commit() once the
+    // draws reading them are issued. Its other regions may still be read by
+    // older frames, the new ring starts without fences.
+    if (this->mapped) {
+        glBindBuffer(this->target, this->buffer);
+        glUnmapBuffer(this->target);
+        glBindBuffer(this->target, 0);
+        this->mapped = nullptr;
+    }
+    this->retired.push_back(this->buffer);
+    this->buffer = 0;
+    this->release();
+    this->allocate(std::max(_needed, 2 * this->regionSize));
+}
+
+size_t StreamingBuffer::
+place(size_t _size) {
+    size_t offset = alignUp(this->head, this->alignment);
+    if (offset + _size > this->regionSize) {
+        this->grow(_size);
+        offset = 0;
+    }
+    if (offset == 0)
+        this->waitFence(this->region);
+
+    this->head = offset + _size;
+    return this->region * this->regionSize + offset;
+}
+
+GLintptr StreamingBuffer::
+write(const void* _data, size_t _size) {
+    PROFILE_ZONE("upload");
+    size_t bufferOffset = this->place(_size);
+    if (this->mapped) {
+        memcpy(this->mapped + bufferOffset, _data, _size);
+    } else {
+        glBindBuffer(this->target, this->buffer);
+        glBufferSubData(this->target, bufferOffset, _size, _data);
+        glBindBuffer(this->target, 0);
+    }
+    return static_cast<GLintptr>(bufferOffset);
+}
+
+void* StreamingBuffer::
+reserve(size_t _size, GLintptr& _offset) {
+    if (!this->mapped)
+        return nullptr;
+    size_t bufferOffset = this->place(_size);
+    _offset = static_cast<GLintptr>(bufferOffset);
+    return this->mapped + bufferOffset;
+}
+
+void StreamingBuffer::
+commit() {
+    if (!this->retired.empty()) {
+        // the driver keeps them alive until the draws reading them are done
+        glDeleteBuffers(static_cast<GLsizei>(this->retired.size()), this->retired.data());
+        this->retired.clear();
+    }
+    if (this->head == 0)
+        return;
+
+    this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    this->region = (this->region + 1) % STREAMING_BUFFER_REGIONS;
+    this->head = 0;
+}
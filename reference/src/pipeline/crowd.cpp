@@ -0,0 +1,97 @@
+#include "pipeline/crowd.hpp"
+
+#include <algorithm>
+
+CrowdMeshPipeline::
+CrowdMeshPipeline(
+    Shader* _shader, 
+    FirstPersonCamera* _camera,
+    BoneWeightedMesh* _mesh,
+    size_t _boneCount,
+    bool _halfPalette
+) : modelStream(GL_SHADER_STORAGE_BUFFER, sizeof(glm::mat4)), 
+    paletteStream(GL_SHADER_STORAGE_BUFFER, _boneCount * (_halfPalette ? sizeof(HalfMat4) : sizeof(glm::mat4))) {
+    std::vector<VertexData> vertices(_mesh->positions.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i].position = _mesh->positions[i];
+        vertices[i].normal = _mesh->hasNormals ? _mesh->normals[i] : glm::vec3(0.0f, 1.0f, 0.0f);
+        vertices[i].influences = _mesh->influences[i];
+        vertices[i].weights = _mesh->weights[i];
+    }
+    this->indexCount = _mesh->indices.size();
+    this->boneCount = _boneCount;
+    this->halfPalette = _halfPalette;
+
+    glGenVertexArrays(1, &this->glo.VAO);
+    glGenBuffers(1, &this->glo.VBO);
+    glGenBuffers(1, &this->glo.EBO);
+
+    glBindVertexArray(this->glo.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->glo.VBO);
+    allocateStaticStorage(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexData), vertices.data());
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glo.EBO); // Bound to VAO
+    allocateStaticStorage(GL_ELEMENT_ARRAY_BUFFER, _mesh->indices.size() * sizeof(unsigned int), _mesh->indices.data());
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, normal));
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 4, GL_UNSIGNED_INT, sizeof(VertexData), (void*)offsetof(VertexData, influences));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, weights));
+
+    glBindVertexArray(0);
+
+    this->shader = _shader;
+    this->camera = _camera;
+    _shader->use();
+    _shader->getUniform<int>("boneCount").set(static_cast<int>(_boneCount));
+}
+
+void CrowdMeshPipeline::
+setInstances(const std::vector<glm::mat4>& _models, const std::vector<glm::mat4>& _palettes) {
+    this->instanceCount = std::min(_models.size(), _palettes.size() / this->boneCount);
+    if (this->instanceCount == 0)
+        return;
+
+    // the streams grow to fit the crowd once and are reused from then on
+    this->modelOffset = this->modelStream.write(_models.data(), this->instanceCount * sizeof(glm::mat4));
+    size_t paletteCount = this->instanceCount * this->boneCount;
+    if (!this->halfPalette) {
+        this->paletteOffset = this->paletteStream.write(_palettes.data(), paletteCount * sizeof(glm::mat4));
+        return;
+    }
+    HalfMat4* halves = static_cast<HalfMat4*>(this->paletteStream.reserve(paletteCount * sizeof(HalfMat4), this->paletteOffset));
+    if (halves) {
+        packPalette(_palettes.data(), paletteCount, halves);
+        return;
+    }
+    this->halfPalettes.resize(paletteCount);
+    packPalette(_palettes.data(), paletteCount, this->halfPalettes.data());
+    this->paletteOffset = this->paletteStream.write(this->halfPalettes.data(), paletteCount * sizeof(HalfMat4));
+}
+
+void CrowdMeshPipeline::
+record(RenderQueue& queue) {
+    if (this->instanceCount == 0)
+        return;
+
+    // camera matrices come from the FrameConstants block
+    DrawPacket packet;
+    packet.program = this->shader->ID;
+    packet.vao = this->glo.VAO;
+    packet.polygonMode = GL_LINE; // we want wire-frame mode
+    packet.primitive = GL_TRIANGLES;
+    packet.addStorage(CROWD_MODEL_BINDING, this->modelStream.getBuffer(), 
+                      this->modelOffset, this->instanceCount * sizeof(glm::mat4));
+    size_t paletteStride = this->halfPalette ? sizeof(HalfMat4) : sizeof(glm::mat4);
+    packet.addStorage(CROWD_PALETTE_BINDING, this->paletteStream.getBuffer(), 
+                      this->paletteOffset, this->instanceCount * this->boneCount * paletteStride);
+    packet.count = static_cast<GLsizei>(this->indexCount);
+    packet.instanceCount = static_cast<GLsizei>(this->instanceCount); // the whole crowd in one call
+    queue.record(packet);
+    queue.addStream(&this->modelStream);
+    queue.addStream(&this->paletteStream);
+}
@@ -2,74 +2,94 @@
 #include "pipeline/mesh.hpp"
 #include <string>
 
+#include "profile/profiler.hpp"
+
 WireframeMeshPipeline::
 WireframeMeshPipeline(
     Shader* _shader, 
     FirstPersonCamera* _camera,
-    BoneWeightedMesh* _mesh
-) {
-    this->indices = _mesh->indices;
+    BoneWeightedMesh* _mesh,
+    SkeletalAnimator* _anim,
+    bool _halfPalette
+) : paletteStream(GL_SHADER_STORAGE_BUFFER, _anim->getSkeleton()->getBoneNum() * (_halfPalette ? sizeof(HalfMat4) : sizeof(glm::mat4))) {
+    this->indices.assign(_mesh->indices.begin(), _mesh->indices.end());
     this->vertices.resize(_mesh->positions.size());
     // Read positions, normals, uvs, influences, weights from _mesh
     for (int i = 0; i<_mesh->positions.size(); i++)
     {
         // VertexData temp;
         this->vertices[i].positions = _mesh->positions[i];
-        // this->vertices[i].normals = _mesh->normals[i];
-        // this->vertices[i].influences = _mesh->influences[i];
-        // this->vertices[i].weights = _mesh->weights[i];
+        this->vertices[i].normals = _mesh->hasNormals ? _mesh->normals[i] : glm::vec3(0.0f);
+        this->vertices[i].uvs = _mesh->hasUVs ? _mesh->uvs[i] : glm::vec2(0.0f);
+        this->vertices[i].influences = _mesh->influences[i];
+        this->vertices[i].weights = _mesh->weights[i];
     }
     glGenVertexArrays(1, &this->glo.VAO); // Allocate a Vertex Array Object to manage data
     glGenBuffers(1, &this->glo.VBO); // Allocate a Vertex Buffer Object to save vertex data
     glGenBuffers(1, &this->glo.EBO); // Allocate an Element Buffer Object to save indices data
 
+    // The geometry never changes, upload it once into immutable storage.
+    // Only the bone palette is streamed per frame.
     glBindVertexArray(this->glo.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, this->glo.VBO); // WARN: A global binding instead of binding to VAO
-    glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(VertexData), &this->vertices[0], GL_STREAM_DRAW);
+    allocateStaticStorage(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(VertexData), this->vertices.data());
     
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glo.EBO); // Bound to EBO
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), &this->indices[0], GL_STREAM_DRAW);
+    allocateStaticStorage(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), this->indices.data());
     // set the vertex attribute pointers
     // vertex Positions
     glEnableVertexAttribArray(0);	
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)0);
-    // // vertex normals
-    // glEnableVertexAttribArray(1);	
-    // glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, normals));
-    // // vertex texture coords
-    // glEnableVertexAttribArray(2);	
-    // glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, uvs));
-    // // ids
-    // glEnableVertexAttribArray(3);
-    // glVertexAttribIPointer(3, 4, GL_INT, sizeof(VertexData), (void*)offsetof(VertexData, influences));
-    // // weights
-    // glEnableVertexAttribArray(4);
-    // glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, weights));
+    // vertex normals
+    glEnableVertexAttribArray(1);	
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, normals));
+    // vertex texture coords
+    glEnableVertexAttribArray(2);	
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, uvs));
+    // ids
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 4, GL_INT, sizeof(VertexData), (void*)offsetof(VertexData, influences));
+    // weights
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, weights));
     
     glBindVertexArray(0);
 
     this->shader = _shader;
     this->camera = _camera;
-
+    this->anim = _anim;
+    // the mesh is drawn at the origin, set once instead of every draw
+    _shader->use();
+    _shader->getUniform<glm::mat4>("model").set(glm::mat4(1.0f));
+    this->palette.resize(_anim->getSkeleton()->getBoneNum());
+    if (_halfPalette)
+        this->halfPalette.resize(this->palette.size());
 }
 
 void WireframeMeshPipeline::
-draw() {
-    // GLint previous;
-    // glGetIntegerv(GL_POLYGON_MODE, &previous); // save previous drawing mode
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // we want wire-frame mode
-
-    glBindVertexArray(this->glo.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->glo.VBO);
-
-    this->shader->use();
-    this->camera->applyToShader(this->shader);
-
-    // Draw using indices 
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(this->indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+record(RenderQueue& queue, float time) {
+    PROFILE_ZONE("palette");
+    // skin on the GPU with this frame's palette
+    this->anim->computeBonePalette(time, this->palette.data());
+    const void* paletteData = this->palette.data();
+    GLsizeiptr paletteBytes = this->palette.size() * sizeof(glm::mat4);
+    if (!this->halfPalette.empty()) {
+        packPalette(this->palette.data(), this->palette.size(), this->halfPalette.data());
+        paletteData = this->halfPalette.data();
+        paletteBytes = this->halfPalette.size() * sizeof(HalfMat4);
+    }
+    GLintptr offset = this->paletteStream.write(paletteData, paletteBytes);
 
-    // glPolygonMode(GL_FRONT_AND_BACK, previous); // restore previous drawing mode
+    // camera matrices come from the FrameConstants block, see FirstPersonCamera::updateFrameConstants
+    DrawPacket packet;
+    packet.program = this->shader->ID;
+    packet.vao = this->glo.VAO;
+    packet.polygonMode = GL_LINE; // we want wire-frame mode
+    packet.primitive = GL_TRIANGLES;
+    packet.addStorage(MESH_PALETTE_BINDING, this->paletteStream.getBuffer(), offset, paletteBytes);
+    packet.count = static_cast<GLsizei>(this->indices.size());
+    queue.record(packet);
+    queue.addStream(&this->paletteStream);
 }
 
-/****************************************My Code end***************************************************/
\ No newline at end of file
+/****************************************My Code end***************************************************/
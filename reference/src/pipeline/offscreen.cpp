@@ -0,0 +1,140 @@
+#include "pipeline/offscreen.hpp"
+
+#include <cstdio>
+#include <vector>
+
+OffscreenTarget::
+OffscreenTarget(int _width, int _height) : width(_width), height(_height) {
+    glGenTextures(1, &this->color);
+    glBindTexture(GL_TEXTURE_2D, this->color);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, _width, _height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &this->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &this->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depth);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+OffscreenTarget::
+~OffscreenTarget() {
+    glDeleteFramebuffers(1, &this->framebuffer);
+    glDeleteRenderbuffers(1, &this->depth);
+    glDeleteTextures(1, &this->color);
+}
+
+bool OffscreenTarget::
+isComplete() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void OffscreenTarget::
+bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glViewport(0, 0, this->width, this->height);
+}
+
+FrameReadback::
+FrameReadback(int _width, int _height) : width(_width), height(_height) {
+    for (Slot& slot : this->slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(_width) * _height * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameReadback::
+~FrameReadback() {
+    for (Slot& slot : this->slots) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool FrameReadback::
+deliver(Slot& _slot, const Callback& _callback, bool _wait) {
+    if (_slot.frame < 0)
+        return false;
+    GLenum status = glClientWaitSync(_slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, _wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _slot.buffer);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(this->width) * this->height * 4, GL_MAP_READ_BIT);
+    if (pixels) {
+        _callback(_slot.frame, static_cast<const unsigned char*>(pixels), this->width, this->height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glDeleteSync(_slot.fence);
+    _slot.fence = nullptr;
+    _slot.frame = -1;
+    return true;
+}
+
+void FrameReadback::
+capture(int _frame, const Callback& _callback) {
+    Slot& slot = this->slots[this->next];
+    // the ring wrapped around, this buffer still holds the oldest frame
+    this->deliver(slot, _callback, true);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = _frame;
+
+    this->next = (this->next + 1) % READBACK_BUFFERS;
+}
+
+void FrameReadback::
+poll(const Callback& _callback) {
+    // oldest first, stop at the first copy still running to keep frames in order
+    for (int i = 0; i < READBACK_BUFFERS; ++i) {
+        Slot& slot = this->slots[(this->next + i) % READBACK_BUFFERS];
+        if (slot.frame >= 0 && !this->deliver(slot, _callback, false))
+            break;
+    }
+}
+
+void FrameReadback::
+flush(const Callback& _callback) {
+    for (int i = 0; i < READBACK_BUFFERS; ++i)
+        this->deliver(this->slots[(this->next + i) % READBACK_BUFFERS], _callback, true);
+}
+
+bool
+writeImagePPM(const std::string& _path, const unsigned char* _rgba, int _width, int _height) {
+    FILE* file = std::fopen(_path.c_str(), "wb");
+    if (!file)
+        return false;
+    std::fprintf(file, "P6\n%d %d\n255\n", _width, _height);
+
+    std::vector<unsigned char> row(static_cast<size_t>(_width) * 3);
+    bool ok = true;
+    for (int y = _height - 1; y >= 0 && ok; --y) {
+        const unsigned char* src = _rgba + static_cast<size_t>(y) * _width * 4;
+        for (int x = 0; x < _width; ++x) {
+            row[3 * x + 0] = src[4 * x + 0];
+            row[3 * x + 1] = src[4 * x + 1];
+            row[3 * x + 2] = src[4 * x + 2];
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
@@ -0,0 +1,150 @@
+#include "pipeline/queue.hpp"
+
+#include <algorithm>
+
+#include "profile/profiler.hpp"
+
+namespace {
+    // never a valid GL name or enum, forces the first bind through
+    const GLuint unknownState = 0xFFFFFFFFu;
+}
+
+void GLStateCache::
+invalidate() {
+    this->program = unknownState;
+    this->vao = unknownState;
+    this->polygonMode = unknownState;
+    this->vertexBuffer = unknownState;
+    this->vertexOffset = -1;
+    this->vertexStride = -1;
+    this->indirectBuffer = unknownState;
+    for (auto& binding : this->storage)
+        binding = { unknownState, -1, -1 };
+}
+
+void GLStateCache::
+useProgram(GLuint _program) {
+    if (this->program == _program)
+        return;
+    glUseProgram(_program);
+    this->program = _program;
+}
+
+void GLStateCache::
+bindVertexArray(GLuint _vao) {
+    if (this->vao == _vao)
+        return;
+    glBindVertexArray(_vao);
+    this->vao = _vao;
+    // vertex buffer bindings are VAO state
+    this->vertexBuffer = unknownState;
+}
+
+void GLStateCache::
+setPolygonMode(GLenum _mode) {
+    if (this->polygonMode == _mode)
+        return;
+    glPolygonMode(GL_FRONT_AND_BACK, _mode);
+    this->polygonMode = _mode;
+}
+
+void GLStateCache::
+bindVertexBuffer(GLuint _buffer, GLintptr _offset, GLsizei _stride) {
+    if (this->vertexBuffer == _buffer && this->vertexOffset == _offset && this->vertexStride == _stride)
+        return;
+    glBindVertexBuffer(0, _buffer, _offset, _stride);
+    this->vertexBuffer = _buffer;
+    this->vertexOffset = _offset;
+    this->vertexStride = _stride;
+}
+
+void GLStateCache::
+bindStorageRange(GLuint _binding, GLuint _buffer, GLintptr _offset, GLsizeiptr _size) {
+    if (_binding >= STATE_CACHE_MAX_STORAGE_BINDINGS) {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, _binding, _buffer, _offset, _size);
+        return;
+    }
+    StorageBinding& current = this->storage[_binding];
+    if (current.buffer == _buffer && current.offset == _offset && current.size == _size)
+        return;
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, _binding, _buffer, _offset, _size);
+    current = { _buffer, _offset, _size };
+}
+
+void GLStateCache::
+bindIndirectBuffer(GLuint _buffer) {
+    if (this->indirectBuffer == _buffer)
+        return;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _buffer);
+    this->indirectBuffer = _buffer;
+}
+
+uint64_t RenderQueue::
+sortKey(const DrawPacket& _packet) {
+    // most expensive change in the highest bits
+    uint64_t key = 0;
+    key |= static_cast<uint64_t>(_packet.program & 0xFFFFF) << 40;
+    key |= static_cast<uint64_t>(_packet.vao & 0xFFFFF) << 20;
+    key |= static_cast<uint64_t>(_packet.polygonMode & 0xFFFFF);
+    return key;
+}
+
+void RenderQueue::
+record(const DrawPacket& _packet) {
+    this->entries.push_back({ sortKey(_packet), this->packets.size() });
+    this->packets.push_back(_packet);
+}
+
+void RenderQueue::
+addStream(StreamingBuffer* _stream) {
+    this->streams.push_back(_stream);
+}
+
+void RenderQueue::
+submit() {
+    PROFILE_ZONE("draw");
+    PROFILE_GPU_ZONE("draw");
+
+    // packets with equal state keep their recording order; the packet index
+    // breaks ties instead of std::stable_sort, which allocates a buffer per call
+    std::sort(this->entries.begin(), this->entries.end(), 
+        [](const Entry& a, const Entry& b) { return a.key != b.key ? a.key < b.key : a.packet < b.packet; });
+
+    for (const Entry& entry : this->entries) {
+        const DrawPacket& packet = this->packets[entry.packet];
+
+        this->state.setPolygonMode(packet.polygonMode);
+        this->state.useProgram(packet.program);
+        this->state.bindVertexArray(packet.vao);
+        if (packet.vertexBuffer)
+            this->state.bindVertexBuffer(packet.vertexBuffer, packet.vertexOffset, packet.vertexStride);
+        for (int i = 0; i < packet.storageCount; ++i) {
+            const auto& range = packet.storage[i];
+            this->state.bindStorageRange(range.binding, range.buffer, range.offset, range.size);
+        }
+
+        if (packet.kind == DrawPacket::Elements) {
+            glDrawElementsInstanced(packet.primitive, packet.count, GL_UNSIGNED_INT, 0, packet.instanceCount);
+        } else {
+            this->state.bindIndirectBuffer(packet.indirectBuffer);
+            if (packet.drawIndexLocation == -1) {
+                glMultiDrawElementsIndirect(packet.primitive, GL_UNSIGNED_INT, (void*)packet.indirectOffset, 
+                                            packet.count, packet.indirectStride);
+            } else {
+                for (GLsizei i = 0; i < packet.count; ++i) {
+                    glUniform1i(packet.drawIndexLocation, i);
+                    glDrawElementsIndirect(packet.primitive, GL_UNSIGNED_INT, 
+                        (void*)(packet.indirectOffset + i * packet.indirectStride));
+                }
+            }
+        }
+    }
+
+    // every draw reading the streams is queued now, fence them
+    for (StreamingBuffer* stream : this->streams)
+        stream->commit();
+
+    this->packets.clear();
+    this->entries.clear();
+    this->streams.clear();
+}
@@ -1,5 +1,6 @@
 #include "pipeline/skeleton.hpp"
 #include "skeletal/animator.hpp"
+#include "profile/profiler.hpp"
 
 WireframeSkeletonPipeline::
 WireframeSkeletonPipeline(
@@ -7,20 +8,20 @@ WireframeSkeletonPipeline(
     FirstPersonCamera* _camera,
     Skeleton* _skel,
     SkeletalAnimator* _anim 
-) {
+) : vertexStream(GL_ARRAY_BUFFER, _skel->getBoneNum() * sizeof(VertexData)) {
     glGenVertexArrays(1, &this->glo.VAO); // Allocate a Vertex Array Object to manage data
-    glGenBuffers(1, &this->glo.VBO); // Allocate a Vertex Buffer Object to save vertex data
     glGenBuffers(1, &this->glo.EBO); // Allocate an Element Buffer Object to save indices data
 
     glBindVertexArray(this->glo.VAO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->glo.EBO); // Bound to VAO
-    
-    glBindBuffer(GL_ARRAY_BUFFER, this->glo.VBO); // WARN: A global binding instead of binding to VAO
 
     // Define how to send data into layout 0
     // Check "res/shader/skeleton.vs"
+    // The vertex buffer itself is bound per frame with glBindVertexBuffer, since
+    // the joint positions live in a different region of the streaming buffer each frame
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, position));
+    glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(VertexData, position));
+    glVertexAttribBinding(0, 0);
     
     glBindVertexArray(0); // unbind VAO
 
@@ -55,67 +56,42 @@ setupIndices() {
 
     // Copy the indice to EBO since they are fixed
     glBindVertexArray(this->glo.VAO); // EBO is bound to VAO
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), this->indices.data(), GL_STATIC_DRAW);
+    allocateStaticStorage(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), this->indices.data());
     glBindVertexArray(0); // unbind VAO
 }
 
 void WireframeSkeletonPipeline::
 updateVertices(float time) {
+    PROFILE_ZONE("FK");
     // get position of each joint from skeletal animator at current frame
-     /****************************************My Code***************************************************/
-    const auto& joints = this->skeleton->getJoints();
-    const auto& keyframes = this->anim->getKeyframes();
-    const auto& timetable = this->anim->getTimetable();
-     /****************************************My Code end***************************************************/
-    // todo can i get the keyframes from animator here and a time stamp here and calculate a interpolation here?
-    for (size_t i = 0; i < this->vertices.size(); ++i) {
-        /*
-            this->vertices[i].position.x = `new_x`;
-            this->vertices[i].position.y = `new_y`;
-            this->vertices[i].position.z = `new_z`;
-        */
-       /****************************************My Code***************************************************/
-        // this->vertices[i].position.x = joints[i].position.x;
-        // this->vertices[i].position.y = joints[i].position.y;
-        // this->vertices[i].position.z = joints[i].position.z;
+    this->globals.resize(this->vertices.size());
+    this->anim->computeGlobalTransforms(time, this->globals.data());
 
-        // for (int j=0;j<timetable.ftime.size();j++)
-        // {
-        //     if (time == timetable.ftime[j])
-        //     {
-                this->vertices[i].position.x = keyframes[i][ceil(time)].positions.x;
-                this->vertices[i].position.y = keyframes[i][ceil(time)].positions.y;
-                this->vertices[i].position.z = keyframes[i][ceil(time)].positions.z;
-        //     }
-        // }
-        /****************************************My Code end***************************************************/
+    for (size_t i = 0; i < this->vertices.size(); ++i) {
+        this->vertices[i].position = glm::vec3(this->globals[i][3]);
     }
 }
 
 void WireframeSkeletonPipeline::
-draw(float time) {
-
-    GLint previous;
-    // glGetIntegerv(GL_POLYGON_MODE, &previous); // save previous drawing mode
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // we want wire-frame mode
-
-    glBindVertexArray(this->glo.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->glo.VBO);
-
-    // update and copy the new vertex data into VBO
+record(RenderQueue& queue, float time) {
+    // update and copy the new vertex data into this frame's region of the stream
     updateVertices(time);
-    glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(VertexData), this->vertices.data(), GL_STREAM_DRAW);
-
-    this->shader->use();
-    this->camera->applyToShader(this->shader);
-
-    // Draw using indices 
-    glDrawElements(GL_LINES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    GLintptr offset = this->vertexStream.write(this->vertices.data(), this->vertices.size() * sizeof(VertexData));
+
+    // camera matrices come from the FrameConstants block, see FirstPersonCamera::updateFrameConstants
+    DrawPacket packet;
+    packet.program = this->shader->ID;
+    packet.vao = this->glo.VAO;
+    packet.polygonMode = GL_LINE; // we want wire-frame mode
+    packet.primitive = GL_LINES;
+    packet.vertexBuffer = this->vertexStream.getBuffer();
+    packet.vertexOffset = offset;
+    packet.vertexStride = sizeof(VertexData);
+    packet.count = static_cast<GLsizei>(this->indices.size());
+    queue.record(packet);
+    queue.addStream(&this->vertexStream);
 
     // Hint: when drawing mesh, you might want to use a draw mode of GL_TRIANGLES
     // For other drawing modes, check
     // https://www.evl.uic.edu/julian/cs488/2005-09-01/fig2-6.gif
-
-    // glPolygonMode(GL_FRONT_AND_BACK, previous); // restore previous drawing mode
-}
\ No newline at end of file
+}
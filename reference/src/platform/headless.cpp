@@ -0,0 +1,113 @@
+#include "platform/headless.hpp"
+
+#include <cstring>
+
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+
+namespace {
+    bool hasExtension(const char* _extensions, const char* _name) {
+        if (!_extensions)
+            return false;
+        size_t length = std::strlen(_name);
+        for (const char* p = std::strstr(_extensions, _name); p; p = std::strstr(p + length, _name)) {
+            bool starts = p == _extensions || p[-1] == ' ';
+            bool ends = p[length] == ' ' || p[length] == '\0';
+            if (starts && ends)
+                return true;
+        }
+        return false;
+    }
+}
+
+HeadlessContext::
+~HeadlessContext() {
+    this->destroy();
+}
+
+bool HeadlessContext::
+create(int _major, int _minor, std::string& err) {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay)
+            this->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (this->display == EGL_NO_DISPLAY)
+        this->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (this->display == EGL_NO_DISPLAY) {
+        err = "No EGL display available.";
+        return false;
+    }
+
+    EGLint major = 0, minor = 0;
+    if (!eglInitialize(this->display, &major, &minor)) {
+        err = "Failed to initialize EGL.";
+        this->display = EGL_NO_DISPLAY;
+        return false;
+    }
+    if (!hasExtension(eglQueryString(this->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        err = "EGL display does not support surfaceless contexts.";
+        this->destroy();
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        err = "EGL display does not support desktop OpenGL.";
+        this->destroy();
+        return false;
+    }
+
+    // we never draw to a surface, any config able to render GL will do.
+    // The surface type defaults to windows, which surfaceless displays lack
+    const EGLint configAttribs[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(this->display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        err = "No EGL config supports desktop OpenGL.";
+        this->destroy();
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, _major,
+        EGL_CONTEXT_MINOR_VERSION, _minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    this->context = eglCreateContext(this->display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (this->context == EGL_NO_CONTEXT) {
+        err = "Failed to create an OpenGL " + std::to_string(_major) + "." + std::to_string(_minor) + " core context.";
+        this->destroy();
+        return false;
+    }
+    if (!eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context)) {
+        err = "Failed to make the EGL context current.";
+        this->destroy();
+        return false;
+    }
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+        err = "Failed to load OpenGL functions.";
+        this->destroy();
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::
+destroy() {
+    if (this->display == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (this->context != EGL_NO_CONTEXT)
+        eglDestroyContext(this->display, this->context);
+    eglTerminate(this->display);
+    this->context = EGL_NO_CONTEXT;
+    this->display = EGL_NO_DISPLAY;
+}
+
+std::string HeadlessContext::
+getRenderer() const {
+    const GLubyte* renderer = this->context != EGL_NO_CONTEXT ? glGetString(GL_RENDERER) : nullptr;
+    return renderer ? reinterpret_cast<const char*>(renderer) : "";
+}
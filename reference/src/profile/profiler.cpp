@@ -0,0 +1,174 @@
+#include "profile/profiler.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// trace tid of the GPU timeline, CPU threads count up from 1
+#define PROFILER_GPU_THREAD 0
+
+namespace {
+    uint32_t currentThreadId() {
+        static std::atomic<uint32_t> nextId{ 1 };
+        thread_local uint32_t id = nextId++;
+        return id;
+    }
+
+    // zone names are identifiers in practice, escape just enough to stay valid JSON
+    void writeJsonString(std::ostream& _out, const char* _s) {
+        _out << '"';
+        for (; *_s; ++_s) {
+            if (*_s == '"' || *_s == '\\')
+                _out << '\\';
+            _out << *_s;
+        }
+        _out << '"';
+    }
+}
+
+Profiler& Profiler::
+get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+int64_t Profiler::
+now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->epoch).count();
+}
+
+void Profiler::
+enable(size_t _maxEvents) {
+    std::lock_guard<std::mutex> lock(this->eventMutex);
+    if (this->events.empty())
+        this->epoch = std::chrono::steady_clock::now();
+    this->maxEvents = _maxEvents;
+    this->events.reserve(_maxEvents);
+    this->enabled = true;
+}
+
+void Profiler::
+disable() {
+    this->enabled = false;
+}
+
+void Profiler::
+record(const char* _name, int64_t _start, int64_t _end) {
+    uint32_t thread = currentThreadId();
+    std::lock_guard<std::mutex> lock(this->eventMutex);
+    if (this->events.size() >= this->maxEvents) {
+        ++this->droppedEvents;
+        return;
+    }
+    this->events.push_back({ _name, thread, _start, _end - _start });
+}
+
+void Profiler::
+calibrateGpu() {
+    // GL_TIMESTAMP counts in the GPU's clock, line it up with ours once
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    this->gpuOffset = this->now() - static_cast<int64_t>(gpuNow);
+    this->gpuCalibrated = true;
+}
+
+GLuint Profiler::
+allocateQuery() {
+    if (this->freeQueries.empty()) {
+        GLuint queries[16];
+        glGenQueries(16, queries);
+        this->freeQueries.insert(this->freeQueries.end(), queries, queries + 16);
+    }
+    GLuint query = this->freeQueries.back();
+    this->freeQueries.pop_back();
+    return query;
+}
+
+void Profiler::
+beginGpuZone(const char* _name) {
+    if (!this->gpuCalibrated)
+        this->calibrateGpu();
+    GpuZone zone = { _name, { this->allocateQuery(), this->allocateQuery() } };
+    glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+    this->openGpuZones.push_back(this->gpuFrames[this->gpuFrame].size());
+    this->gpuFrames[this->gpuFrame].push_back(zone);
+}
+
+void Profiler::
+endGpuZone() {
+    if (this->openGpuZones.empty())
+        return;
+    GpuZone& zone = this->gpuFrames[this->gpuFrame][this->openGpuZones.back()];
+    this->openGpuZones.pop_back();
+    glQueryCounter(zone.queries[1], GL_TIMESTAMP);
+}
+
+void Profiler::
+collectGpuFrame(int _frame, bool _wait) {
+    for (const GpuZone& zone : this->gpuFrames[_frame]) {
+        GLint available = 0;
+        glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available || _wait) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+
+            std::lock_guard<std::mutex> lock(this->eventMutex);
+            if (this->events.size() < this->maxEvents) {
+                this->events.push_back({ zone.name, PROFILER_GPU_THREAD, static_cast<int64_t>(begin) + this->gpuOffset, 
+                                         static_cast<int64_t>(end - begin) });
+            } else {
+                ++this->droppedEvents;
+            }
+        } else {
+            // still running after PROFILER_GPU_FRAMES frames, not worth a stall
+            ++this->droppedEvents;
+        }
+        this->freeQueries.push_back(zone.queries[0]);
+        this->freeQueries.push_back(zone.queries[1]);
+    }
+    this->gpuFrames[_frame].clear();
+}
+
+void Profiler::
+beginFrame() {
+    // zones left open by the previous frame can not be matched any more
+    this->openGpuZones.clear();
+    this->gpuFrame = (this->gpuFrame + 1) % PROFILER_GPU_FRAMES;
+    this->collectGpuFrame(this->gpuFrame, false);
+}
+
+bool Profiler::
+writeChromeTrace(const std::string& _path) {
+    for (int i = 1; i <= PROFILER_GPU_FRAMES; ++i)
+        this->collectGpuFrame((this->gpuFrame + i) % PROFILER_GPU_FRAMES, true);
+
+    std::ofstream out(_path);
+    if (!out) {
+        std::cout << "Failed to write trace file: " << _path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(this->eventMutex);
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << PROFILER_GPU_THREAD 
+        << ",\"args\":{\"name\":\"GPU\"}}";
+    char number[64];
+    for (const Event& event : this->events) {
+        // trace timestamps are in microseconds
+        out << ",\n{\"name\":";
+        writeJsonString(out, event.name);
+        std::snprintf(number, sizeof(number), "%.3f", event.start / 1000.0);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << number;
+        std::snprintf(number, sizeof(number), "%.3f", event.duration / 1000.0);
+        out << ",\"dur\":" << number << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << this->droppedEvents << "}}\n";
+
+    std::cout << "Wrote " << this->events.size() << " trace events to " << _path;
+    if (this->droppedEvents)
+        std::cout << " (" << this->droppedEvents << " dropped)";
+    std::cout << std::endl;
+    return true;
+}
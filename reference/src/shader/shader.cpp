@@ -1,8 +1,41 @@
 #include "shader/shader.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+namespace {
+    const char binaryCacheMagic[4] = {'S', 'P', 'B', 'C'};
+
+    // 64-bit FNV-1a, good enough to key a local cache
+    void hashBytes(uint64_t& hash, const char* data, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+    }
+
+    void hashString(uint64_t& hash, const std::string& str)
+    {
+        // hash the length too so that moving text between stages changes the key
+        uint64_t len = str.size();
+        hashBytes(hash, reinterpret_cast<const char*>(&len), sizeof(len));
+        hashBytes(hash, str.data(), str.size());
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* str = glGetString(name);
+        return str ? reinterpret_cast<const char*>(str) : "";
+    }
+}
 
 Shader::Shader(
     const char* vertexPath, 
@@ -54,14 +87,30 @@ Shader::Shader(
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
 
+    // 2. reuse the linked program from the binary cache if we can
+    std::string cachePath = binaryCachePath(vertexCode, fragmentCode, geometryCode);
+    if (cachePath.empty() || !loadProgramBinary(cachePath))
+        compileProgram(vertexCode, fragmentCode, geometryCode, cachePath);
+
+    // 4. resolve the active uniforms once so the setters never query the driver
+    reflectUniforms();
+}
+
+void Shader::
+compileProgram(
+    const std::string& vertexCode, 
+    const std::string& fragmentCode, 
+    const std::string& geometryCode,
+    const std::string& cachePath
+)
+{
+    bool hasGeometry = !geometryCode.empty();
     const char* vShaderCode = vertexCode.c_str();
     const char * fShaderCode = fragmentCode.c_str();
     const char* gShaderCode = geometryCode.c_str();
     
-    // 2. compile shaders
+    // 3. compile shaders
     unsigned int vertex, fragment, geometry;
-    int success;
-    char infoLog[512];
     
     // vertex shader
     vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -76,7 +125,7 @@ Shader::Shader(
     checkCompileErrors(fragment, "FRAGMENT");
     
     // geometry shader
-    if (geometryPath != NULL)
+    if (hasGeometry)
     {
         geometry = glCreateShader(GL_GEOMETRY_SHADER);
         glShaderSource(geometry, 1, &gShaderCode, NULL);
@@ -88,22 +137,61 @@ Shader::Shader(
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
-    if (geometryPath != NULL)
+    if (hasGeometry)
     {
         glAttachShader(ID, geometry);
     }
+    if (!cachePath.empty())
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    if (!cachePath.empty())
+        saveProgramBinary(cachePath);
     
     // delete the shaders as they're linked into our program now and no longer necessery
     glDeleteShader(vertex);
     glDeleteShader(fragment);
-    if (geometryPath != NULL)
+    if (hasGeometry)
     {
         glDeleteShader(geometry);
     }
 }
 
+void Shader::
+reflectUniforms()
+{
+    this->uniformLocations.clear();
+
+    GLint numUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+
+    for (GLint i = 0; i < numUniforms; ++i) {
+        GLsizei nameLength = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), nameLength);
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        if (location == -1)
+            continue;
+        this->uniformLocations[name] = location;
+
+        // arrays are reported as "name[0]", make "name" and every element resolvable too
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string baseName = name.substr(0, name.size() - 3);
+            this->uniformLocations[baseName] = location;
+            for (GLint k = 1; k < size; ++k) {
+                std::string element = baseName + "[" + std::to_string(k) + "]";
+                this->uniformLocations[element] = glGetUniformLocation(ID, element.c_str());
+            }
+        }
+    }
+}
+
 void Shader::
 checkCompileErrors(GLuint shader, std::string type)
 {
@@ -131,4 +219,111 @@ checkCompileErrors(GLuint shader, std::string type)
                 exit(-1);
             }
         }
-    }
\ No newline at end of file
+    }
+
+std::string Shader::
+binaryCachePath(
+    const std::string& vertexCode, 
+    const std::string& fragmentCode, 
+    const std::string& geometryCode
+) const
+{
+    if (binaryCacheDir.empty())
+        return "";
+
+    // drivers are allowed to support no binary formats at all
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0)
+        return "";
+
+    // a binary is only valid for the driver that produced it
+    uint64_t hash = 14695981039346656037ull;
+    hashString(hash, glString(GL_VENDOR));
+    hashString(hash, glString(GL_RENDERER));
+    hashString(hash, glString(GL_VERSION));
+    hashString(hash, vertexCode);
+    hashString(hash, fragmentCode);
+    hashString(hash, geometryCode);
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(binaryCacheDir) / name).string();
+}
+
+bool Shader::
+loadProgramBinary(const std::string& cachePath)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[sizeof(binaryCacheMagic)];
+    GLenum format;
+    GLint length;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!file || memcmp(magic, binaryCacheMagic, sizeof(magic)) != 0 || length <= 0)
+        return false;
+
+    // a truncated or corrupted cache must not make us allocate what it claims
+    std::error_code error;
+    std::uintmax_t fileSize = std::filesystem::file_size(cachePath, error);
+    std::uintmax_t headerSize = sizeof(magic) + sizeof(format) + sizeof(length);
+    if (error || fileSize < headerSize || static_cast<std::uintmax_t>(length) > fileSize - headerSize)
+        return false;
+
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (!file)
+        return false;
+
+    ID = glCreateProgram();
+    glProgramBinary(ID, format, binary.data(), length);
+
+    GLint success;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success) {
+        // the driver rejected it (e.g. after an update), compile from source instead
+        glDeleteProgram(ID);
+        ID = 0;
+        return false;
+    }
+    return true;
+}
+
+void Shader::
+saveProgramBinary(const std::string& cachePath) const
+{
+    GLint length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+    std::error_code ec;
+    std::filesystem::path path(cachePath);
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // write to a temporary file first so that a concurrent launch never reads half a binary
+    std::filesystem::path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "WARNING::SHADER::BINARY_CACHE_NOT_WRITABLE: " << cachePath << std::endl;
+            return;
+        }
+        file.write(binaryCacheMagic, sizeof(binaryCacheMagic));
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        file.write(binary.data(), length);
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+        std::filesystem::remove(tmpPath, ec);
+}
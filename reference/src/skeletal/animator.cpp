@@ -5,34 +5,261 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <skeletal/skeleton.hpp>
+#include "skeletal/lod.hpp"
+#include "profile/profiler.hpp"
+#include "memory/scratch.hpp"
 /***********************my code end*****************************/
+#include "skeletal/blend.hpp"
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+AnimationClip::
+AnimationClip(const AnimationClip& _other, const allocator_type& _alloc) :
+    name(_other.name, _alloc),
+    keyframes(_other.keyframes, _alloc),
+    timetable(_other.timetable, _alloc.resource()),
+    constant(_other.constant, _alloc),
+    interpolation(_other.interpolation, _alloc),
+    splines(_other.splines, _alloc),
+    halfKeys(_other.halfKeys, _alloc) {
+}
+
+AnimationClip::
+AnimationClip(AnimationClip&& _other, const allocator_type& _alloc) :
+    name(std::move(_other.name), _alloc),
+    keyframes(std::move(_other.keyframes), _alloc),
+    timetable(std::move(_other.timetable), _alloc.resource()),
+    constant(std::move(_other.constant), _alloc),
+    interpolation(std::move(_other.interpolation), _alloc),
+    splines(std::move(_other.splines), _alloc),
+    halfKeys(std::move(_other.halfKeys), _alloc) {
+}
+
+size_t TimeTable::
+getBucket(float _time) const {
+    // monotonic in `_time`, buildLookup relies on it
+    float bucket = (_time - this->ftime.front()) * this->lookupScale;
+    if (!(bucket > 0.0f))
+        return 0;
+    return std::min(static_cast<size_t>(bucket), this->lookup.size() - 1);
+}
+
+void TimeTable::
+buildLookup() {
+    this->lookup.clear();
+    if (this->ftime.empty())
+        return;
+    size_t bucketCount = this->ftime.size() * TIME_LOOKUP_BUCKETS_PER_KEY;
+    float range = this->ftime.back() - this->ftime.front();
+    this->lookupScale = range > 0.0f ? bucketCount / range : 0.0f;
+    this->lookup.resize(bucketCount, 0);
+
+    // the last key in an earlier bucket is before any time in bucket b
+    size_t k = 0;
+    for (size_t b = 0; b < bucketCount; ++b) {
+        while (k + 1 < this->ftime.size() && this->getBucket(this->ftime[k + 1]) < b)
+            ++k;
+        this->lookup[b] = static_cast<unsigned int>(k);
+    }
+}
+
+size_t TimeTable::
+findKey(float _time) const {
+    size_t k = this->lookup[this->getBucket(_time)];
+    while (k + 1 < this->ftime.size() && this->ftime[k + 1] <= _time)
+        ++k;
+    return k;
+}
+
+SkeletalAnimator::
+SkeletalAnimator(std::pmr::memory_resource* _resource) :
+    clips(_resource) {
+}
+
+size_t SkeletalAnimator::
+estimateLoadBytes(const tinygltf::Model& mdl, bool _halfKeys) {
+    if (mdl.animations.empty())
+        return 0;
+    size_t jointCount = mdl.skins.empty() ? 0 : mdl.skins[0].joints.size();
+    size_t bytes = 0;
+    for (const tinygltf::Animation& animation : mdl.animations) {
+        bytes += sizeof(AnimationClip) + animation.name.size() + 1;
+        size_t keysVector = _halfKeys ? sizeof(std::pmr::vector<HalfQuat>) : sizeof(std::pmr::vector<Keyframes>);
+        size_t keySize = _halfKeys ? sizeof(HalfQuat) : sizeof(Keyframes);
+        bytes += jointCount * (keysVector + sizeof(std::pmr::vector<glm::quat>) + 1 + sizeof(Interpolation));
+        for (const tinygltf::AnimationChannel& channel : animation.channels) {
+            if (channel.target_path != "rotation")
+                continue;
+            const tinygltf::AnimationSampler& sampler = animation.samplers[channel.sampler];
+            size_t keyCount = mdl.accessors[sampler.input].count;
+            bytes += keyCount * (keySize + sizeof(float)); // keys, plus an upper bound for the time table
+            bytes += keyCount * TIME_LOOKUP_BUCKETS_PER_KEY * sizeof(unsigned int); // and its lookup
+            if (sampler.interpolation == "CUBICSPLINE")
+                bytes += mdl.accessors[sampler.output].count * sizeof(glm::quat); // 3 per key, a, b and c per segment
+        }
+    }
+    return bytes;
+}
 
 bool SkeletalAnimator::
 loadFromTinyGLTF(
     const tinygltf::Model& mdl, 
     std::string& warn, 
     std::string& err,
-    Skeleton* _skel
+    Skeleton* _skel,
+    bool _halfKeys
 ) {
+    PROFILE_ZONE("load: animation");
     if (mdl.animations.size() == 0) {
         err = "No skeletal animation data in file.";
         return false;
     }
 
-    const tinygltf::Animation& gltfAnim = mdl.animations[0];
+    this->skeleton = _skel;
+    this->keyframeError = HalfPrecisionError();
+    this->clips.clear();
+    this->clips.resize(mdl.animations.size());
+    for (size_t a = 0; a < mdl.animations.size(); ++a) {
+        if (!_halfKeys) {
+            if (!this->loadClip(mdl, mdl.animations[a], this->clips[a], warn, err)) {
+                err = "Animation " + std::to_string(a) + ": " + err;
+                return false;
+            }
+            continue;
+        }
+
+        // the float keys only live on the heap while the clip loads
+        AnimationClip staging(AnimationClip::allocator_type(std::pmr::new_delete_resource()));
+        if (!this->loadClip(mdl, mdl.animations[a], staging, warn, err)) {
+            err = "Animation " + std::to_string(a) + ": " + err;
+            return false;
+        }
+        compressClip(staging, this->keyframeError);
+        this->clips[a] = AnimationClip(std::move(staging), this->clips.get_allocator());
+    }
+    if (_halfKeys)
+        this->keyframeError.finish();
+    return true;
+}
+
+void SkeletalAnimator::
+compressClip(AnimationClip& clip, HalfPrecisionError& error) {
+    clip.halfKeys.resize(clip.keyframes.size());
+    for (size_t j = 0; j < clip.keyframes.size(); ++j) {
+        auto& halves = clip.halfKeys[j];
+        halves.reserve(clip.keyframes[j].size());
+        for (const Keyframes& key : clip.keyframes[j]) {
+            halves.push_back(packQuat(key.orientation));
+            error.addRotation(key.orientation, unpackQuat(halves.back()));
+        }
+    }
+    clip.keyframes.clear();
+    clip.keyframes.shrink_to_fit();
+}
+
+size_t SkeletalAnimator::
+getKeyframeBytes() const {
+    size_t bytes = 0;
+    for (const AnimationClip& clip : this->clips) {
+        for (const auto& keys : clip.keyframes)
+            bytes += keys.size() * sizeof(Keyframes);
+        for (const auto& keys : clip.halfKeys)
+            bytes += keys.size() * sizeof(HalfQuat);
+    }
+    return bytes;
+}
+
+HalfPrecisionError SkeletalAnimator::
+compressKeyframes() {
+    // clips are all compressed or none
+    if (!this->clips.empty() && !this->clips[0].halfKeys.empty())
+        return this->keyframeError;
+    this->keyframeError = HalfPrecisionError();
+    for (AnimationClip& clip : this->clips) {
+        if (clip.halfKeys.empty())
+            compressClip(clip, this->keyframeError);
+    }
+    this->keyframeError.finish();
+    return this->keyframeError;
+}
+
+int SkeletalAnimator::
+findClip(const std::string& name) const {
+    for (size_t c = 0; c < this->clips.size(); ++c) {
+        if (std::string_view(this->clips[c].name) == name)
+            return static_cast<int>(c);
+    }
+    return -1;
+}
+
+// quaternion `_index` of a glTF rotation output, stored xyzw
+static glm::quat
+readQuaternion(const tinygltf_DataGetter& _values, size_t _index) {
+    float xyzw[4];
+    memcpy(xyzw, &_values.data[_index * _values.stride], sizeof(xyzw));
+    return glm::quat(xyzw[3], xyzw[0], xyzw[1], xyzw[2]);
+}
+
+// Hermite segments of a CUBICSPLINE channel as polynomial coefficients, see
+// AnimationClip::splines. `_keys` from `_firstKey` on are the channel's values,
+// the tangents are read from `_values` and scaled to each segment's duration.
+static void
+buildSplines(
+    const tinygltf_DataGetter& _times,
+    const tinygltf_DataGetter& _values,
+    const std::pmr::vector<Keyframes>& _keys,
+    size_t _firstKey,
+    std::pmr::vector<glm::quat>& _splines
+) {
+    _splines.assign(_keys.empty() ? 0 : 3 * (_keys.size() - 1), glm::quat(0.0f, 0.0f, 0.0f, 0.0f));
+    for (size_t k = _firstKey; k + 1 < _keys.size(); ++k) {
+        size_t i = k - _firstKey;
+        float t0, t1;
+        memcpy(&t0, &_times.data[i * _times.stride], sizeof(float));
+        memcpy(&t1, &_times.data[(i + 1) * _times.stride], sizeof(float));
+        float duration = t1 - t0;
+
+        const glm::quat& p0 = _keys[k].orientation;
+        const glm::quat& p1 = _keys[k + 1].orientation;
+        glm::quat m0 = readQuaternion(_values, 3 * i + 2) * duration;        // out-tangent of key k
+        glm::quat m1 = readQuaternion(_values, 3 * (i + 1) + 0) * duration;  // in-tangent of key k+1
+
+        // h00 p0 + h10 m0 + h01 p1 + h11 m1, collected by powers of s
+        _splines[3 * k + 0] = p0 * 2.0f + m0 - p1 * 2.0f + m1;
+        _splines[3 * k + 1] = p1 * 3.0f - p0 * 3.0f - m0 * 2.0f - m1;
+        _splines[3 * k + 2] = m0;
+    }
+}
+
+bool SkeletalAnimator::
+loadClip(
+    const tinygltf::Model& mdl,
+    const tinygltf::Animation& gltfAnim,
+    AnimationClip& clip,
+    std::string& warn,
+    std::string& err
+) {
+    clip.name.assign(gltfAnim.name);
 
     //TimeGetter will grab the timestamp of a given keyframe.
     //KeyGetter will grab the actual keyframe data.
     tinygltf_DataGetter timeGetter, keyGetter;
 
     float maxTime = 0.0f; 
+    bool timesLoaded = false;   // the time table comes from the first rotation channel
+    size_t ignoredChannels = 0;
 
     /***********************my code*****************************/
-    auto joints = _skel->getJoints();
-    int root = _skel->getRoot();
-    this->keyframes.resize(joints.size()); // let the keyframes' size as large as the number of nodes.
+    const auto& joints = this->skeleton->getJoints();
+    int root = this->skeleton->getRoot();
+    clip.keyframes.resize(joints.size()); // let the keyframes' size as large as the number of nodes.
     /***********************my code end*****************************/
+    clip.interpolation.assign(joints.size(), Interpolation::Linear);
+    clip.splines.resize(joints.size());
 
     for (size_t i = 0; i < gltfAnim.channels.size(); ++i)
     {
@@ -46,6 +273,13 @@ loadFromTinyGLTF(
 
         if (timeGetter.len == 0 || keyGetter.len == 0)
             continue;
+
+        // We only care about joint rotation, translation/scale/weights are skipped
+        // before their (differently sized) outputs are validated
+        if (channel.target_path != "rotation") {
+            ++ignoredChannels;
+            continue;
+        }
         
         if (timeGetter.elementSize != sizeof(float)) {
             err = "The time of the animation per keyframe should be a float number";
@@ -62,9 +296,18 @@ loadFromTinyGLTF(
         // Rather than correct after the fact and swap X/W coordinates,
         // we'll just do this.
         
-        // We only care about joint rotation.
+        // cubic splines store in-tangent, value, out-tangent per key, read the values only
+        size_t valueStride = sampler.interpolation == "CUBICSPLINE" ? 3 : 1;
+        size_t valueOffset = valueStride == 3 ? 1 : 0;
+
         if (channel.target_path == "rotation") {
-            for (size_t k = 0; k < timeGetter.len && k < keyGetter.len; ++k) {
+            auto& jointKeys = clip.keyframes[channel.target_node];
+            size_t firstKey = jointKeys.size();
+            jointKeys.reserve(jointKeys.size() + timeGetter.len);
+            if (!timesLoaded)
+                clip.timetable.ftime.reserve(timeGetter.len);
+            for (size_t k = 0; k < timeGetter.len && k < keyGetter.len / valueStride; ++k) {
+                size_t key = k * valueStride + valueOffset;
                 float fTime;
                 float x, y, z, w;
 
@@ -73,10 +316,10 @@ loadFromTinyGLTF(
                 if (fTime > maxTime)
                     maxTime = fTime;
 
-                memcpy(&x, &keyGetter.data[k * keyGetter.stride + 0 * sizeof(float)], sizeof(float));
-                memcpy(&y, &keyGetter.data[k * keyGetter.stride + 1 * sizeof(float)], sizeof(float));
-                memcpy(&z, &keyGetter.data[k * keyGetter.stride + 2 * sizeof(float)], sizeof(float));
-                memcpy(&w, &keyGetter.data[k * keyGetter.stride + 3 * sizeof(float)], sizeof(float));
+                memcpy(&x, &keyGetter.data[key * keyGetter.stride + 0 * sizeof(float)], sizeof(float));
+                memcpy(&y, &keyGetter.data[key * keyGetter.stride + 1 * sizeof(float)], sizeof(float));
+                memcpy(&z, &keyGetter.data[key * keyGetter.stride + 2 * sizeof(float)], sizeof(float));
+                memcpy(&w, &keyGetter.data[key * keyGetter.stride + 3 * sizeof(float)], sizeof(float));
                 
                 // std::cout << "Animation Loaded for node " <<  channel.target_node << " at " << fTime 
                 //           << " with data " << x << " " << y << " " << z << " " << w << std::endl;
@@ -88,12 +331,23 @@ loadFromTinyGLTF(
                  * */
                 /***********************my code*****************************/
                 Keyframes temp = {glm::quat(w,x,y,z), glm::vec3(0,0,0)};
-                this->keyframes[channel.target_node].push_back(temp);
+                clip.keyframes[channel.target_node].push_back(temp);
                 //add the timestamp into the time structure.
-                if (i==0) // using a flag to store time data once.
-                    this->timetable.ftime.push_back(fTime);
+                if (!timesLoaded) // using a flag to store time data once.
+                    clip.timetable.ftime.push_back(fTime);
                 /***********************my code end*****************************/
             }
+
+            // a missing interpolation is LINEAR
+            Interpolation mode = Interpolation::Linear;
+            if (sampler.interpolation == "STEP")
+                mode = Interpolation::Step;
+            else if (sampler.interpolation == "CUBICSPLINE")
+                mode = Interpolation::CubicSpline;
+            clip.interpolation[channel.target_node] = mode;
+            if (mode == Interpolation::CubicSpline)
+                buildSplines(timeGetter, keyGetter, jointKeys, firstKey, clip.splines[channel.target_node]);
+            timesLoaded = true;
         // } else{
         //     for (size_t k = 0; k < timeGetter.len && k < keyGetter.len; ++k) {
         //         Keyframes temp = {glm::quat(0,0,0,1), glm::vec3(0,0,0)};
@@ -101,9 +355,13 @@ loadFromTinyGLTF(
         //     }
         }
     }
+    if (ignoredChannels > 0) {
+        warn += "\nIgnored " + std::to_string(ignoredChannels) + " translation/scale/weight channels, " \
+                "only joint rotations are animated.";
+    }
     /***********************my code*****************************/
-    const auto jointInvBindMatrix = joints;
-    for(int f=0;f<this->timetable.ftime.size();f++)
+    // keyframe positions: the joint origin under the keyed rotation of its global bind transform
+    for(int f=0;f<clip.timetable.ftime.size();f++)
     {
         // for(int j_id=joints.size()-1;j_id>=0;j_id--)
         for(int j_id=0; j_id<joints.size();j_id++)
@@ -123,20 +381,213 @@ loadFromTinyGLTF(
             //     joints[j_id].invBindMatrix = joints[joints[j_id].Parent].invBindMatrix * trans;
             // }
 
-            joints[j_id].invBindMatrix = glm::mat4_cast(this->keyframes[j_id][f].orientation) * jointInvBindMatrix[j_id].invBindMatrix;
-
-        }
-
-        for(int j_id=0;j_id<joints.size();j_id++)
-        {
+            if (f >= clip.keyframes[j_id].size()) // joint without rotation keys
+                continue;
             glm::vec4 temp = glm::vec4(0,0,0,1.0f);
-            temp = joints[j_id].invBindMatrix * temp;
-            this->keyframes[j_id][f].positions.x = temp.x;
-            this->keyframes[j_id][f].positions.y = temp.y;
-            this->keyframes[j_id][f].positions.z = temp.z;
+            temp = glm::mat4_cast(clip.keyframes[j_id][f].orientation) * (joints[j_id].invBindMatrix * temp);
+            clip.keyframes[j_id][f].positions.x = temp.x;
+            clip.keyframes[j_id][f].positions.y = temp.y;
+            clip.keyframes[j_id][f].positions.z = temp.z;
             // std::cout<<"Original position of joint "<<i<<":("<<temp.x<<","<<temp.y<<","<<temp.z<<")"<<std::endl;
         }
     }
     /***********************my code end*****************************/
+
+    clip.timetable.buildLookup();
+
+    // tracks that hold one rotation throughout, incremental FK never revisits them
+    clip.constant.assign(joints.size(), 1);
+    for (size_t j = 0; j < joints.size(); ++j) {
+        const auto& keys = clip.keyframes[j];
+        for (size_t k = 1; k < keys.size() && clip.constant[j]; ++k) {
+            if (keys[k].orientation != keys[0].orientation)
+                clip.constant[j] = 0;
+        }
+        // equal keys with non-zero tangents still overshoot in between
+        for (const glm::quat& coefficient : clip.splines[j]) {
+            if (coefficient != glm::quat(0.0f, 0.0f, 0.0f, 0.0f))
+                clip.constant[j] = 0;
+        }
+    }
     return true; 
-}
\ No newline at end of file
+}
+
+// keyframe pair around `time` in a clip's time table, and the blend factor between them
+static void
+findKeys(const TimeTable& timetable, float time, size_t& k0, size_t& k1, float& t) {
+    const auto& ftime = timetable.ftime;
+    k0 = k1 = 0;
+    t = 0.0f;
+    if (ftime.empty() || time <= ftime.front())
+        return;
+    if (time >= ftime.back()) {
+        k0 = k1 = ftime.size() - 1;
+        return;
+    }
+    k0 = timetable.findKey(time);
+    k1 = k0 + 1;
+    t = (time - ftime[k0]) / (ftime[k1] - ftime[k0]);
+}
+
+void SkeletalAnimator::
+sampleJoints(const AnimationClip& _clip, float _time, const int* _joints, size_t _jointCount, glm::quat* rotations) const {
+    const auto& joints = this->skeleton->getJoints();
+
+    // keyframe pair around `time`, shared by every joint
+    size_t k0, k1;
+    float t;
+    findKeys(_clip.timetable, _time, k0, k1, t);
+
+    for (size_t i = 0; i < _jointCount; ++i) {
+        int j = _joints[i];
+        size_t keyCount = _clip.getKeyCount(j);
+        Interpolation mode = _clip.interpolation[j];
+        if (keyCount == 0) {
+            // not animated, stay at the bind pose
+            rotations[j] = joints[j].baseQuaternion;
+        } else if (k1 >= keyCount) {
+            rotations[j] = _clip.getKey(j, keyCount - 1);
+        } else if (k0 == k1 || mode == Interpolation::Step) {
+            rotations[j] = _clip.getKey(j, k0);
+        } else if (mode == Interpolation::CubicSpline) {
+            // one Horner step on the precomputed coefficients
+            const glm::quat* segment = &_clip.splines[j][3 * k0];
+            rotations[j] = glm::normalize(((segment[0] * t + segment[1]) * t + segment[2]) * t + _clip.getKey(j, k0));
+        } else {
+            rotations[j] = glm::slerp(_clip.getKey(j, k0), _clip.getKey(j, k1), t);
+        }
+    }
+}
+
+void SkeletalAnimator::
+sampleRotations(float time, glm::quat* rotations, const SkeletonLODLevel* lod) const {
+    this->sampleClip(0, time, rotations, lod);
+}
+
+void SkeletalAnimator::
+sampleClip(int clip, float time, glm::quat* rotations, const SkeletonLODLevel* lod) const {
+    std::span<const int> evalOrder = lod ? std::span<const int>(lod->evalOrder) : std::span<const int>(this->skeleton->getEvalOrder());
+    this->sampleJoints(this->clips[clip], time, evalOrder.data(), evalOrder.size(), rotations);
+}
+
+void SkeletalAnimator::
+sampleClip(int clip, float time, const int* joints, size_t jointCount, glm::quat* rotations) const {
+    this->sampleJoints(this->clips[clip], time, joints, jointCount, rotations);
+}
+
+void SkeletalAnimator::
+blendLayers(const AnimationLayer* layers, size_t layerCount, glm::quat* rotations, const SkeletonLODLevel* lod) const {
+    const auto& joints = this->skeleton->getJoints();
+    std::span<const int> evalOrder = lod ? std::span<const int>(lod->evalOrder) : std::span<const int>(this->skeleton->getEvalOrder());
+
+    // a full-weight, unmasked override at the bottom replaces every joint,
+    // otherwise start from the bind pose
+    size_t first = 0;
+    if (layerCount > 0 && !layers[0].mask && layers[0].mode == BlendMode::Override && layers[0].weight >= 1.0f) {
+        this->sampleJoints(this->clips[layers[0].clip], layers[0].time, evalOrder.data(), evalOrder.size(), rotations);
+        first = 1;
+    } else {
+        for (int j_id : evalOrder)
+            rotations[j_id] = joints[j_id].baseQuaternion;
+    }
+
+    ScratchScope scratch;
+    glm::quat* sampled = scratch.allocate<glm::quat>(joints.size());
+    int* selected = scratch.allocate<int>(joints.size());
+    for (size_t l = first; l < layerCount; ++l) {
+        const AnimationLayer& layer = layers[l];
+        if (layer.weight <= 0.0f)
+            continue;
+
+        // only the joints of the mask are sampled at all
+        std::span<const int> layerJoints = evalOrder;
+        if (layer.mask) {
+            size_t count = 0;
+            for (int j_id : layer.mask->joints) {
+                if (!lod || lod->evaluated[j_id])
+                    selected[count++] = j_id;
+            }
+            layerJoints = std::span<const int>(selected, count);
+        }
+        const AnimationClip& clip = this->clips[layer.clip];
+        this->sampleJoints(clip, layer.time, layerJoints.data(), layerJoints.size(), sampled);
+
+        float weight = std::min(layer.weight, 1.0f);
+        if (layer.mode == BlendMode::Override) {
+            for (int j_id : layerJoints)
+                rotations[j_id] = weight >= 1.0f ? sampled[j_id] : glm::slerp(rotations[j_id], sampled[j_id], weight);
+        } else {
+            // difference to the clip's first key, the additive reference pose
+            for (int j_id : layerJoints) {
+                if (clip.getKeyCount(j_id) == 0)
+                    continue;
+                glm::quat delta = glm::inverse(clip.getKey(j_id, 0)) * sampled[j_id];
+                if (weight < 1.0f)
+                    delta = glm::slerp(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), delta, weight);
+                rotations[j_id] = rotations[j_id] * delta;
+            }
+        }
+    }
+}
+
+void SkeletalAnimator::
+computeGlobalTransforms(const glm::quat* rotations, glm::mat4* globals, const SkeletonLODLevel* lod) const {
+    const auto& joints = this->skeleton->getJoints();
+    std::span<const int> evalOrder = lod ? std::span<const int>(lod->evalOrder) : std::span<const int>(this->skeleton->getEvalOrder());
+    for (int j_id : evalOrder) {
+        glm::mat4 local = this->skeleton->getLocalTransform(j_id, rotations[j_id]);
+        int parent = joints[j_id].Parent;
+        globals[j_id] = parent == -1 ? local : globals[parent] * local;
+    }
+
+    if (lod) {
+        for (int j_id : lod->skipped)
+            globals[j_id] = globals[lod->proxy[j_id]] * lod->proxyOffset[j_id];
+    }
+}
+
+void SkeletalAnimator::
+computeGlobalTransforms(float time, glm::mat4* globals, const SkeletonLODLevel* lod) const {
+    ScratchScope scratch;
+    glm::quat* rotations = scratch.allocate<glm::quat>(this->skeleton->getBoneNum());
+    this->sampleRotations(time, rotations, lod);
+    this->computeGlobalTransforms(rotations, globals, lod);
+}
+
+void SkeletalAnimator::
+applyInverseBind(glm::mat4* palette, const SkeletonLODLevel* lod) const {
+    const auto& inverseBind = this->skeleton->getInverseBindMatrices();
+    if (!lod) {
+        for (size_t j = 0; j < inverseBind.size(); ++j) {
+            palette[j] = palette[j] * inverseBind[j];
+        }
+        return;
+    }
+
+    // proxy global * offset * inverse bind is exactly the proxy's skinning matrix
+    for (int j_id : lod->evalOrder)
+        palette[j_id] = palette[j_id] * inverseBind[j_id];
+    for (int j_id : lod->skipped)
+        palette[j_id] = palette[lod->proxy[j_id]];
+}
+
+void SkeletalAnimator::
+computeBonePalette(float time, glm::mat4* palette, const SkeletonLODLevel* lod) const {
+    this->computeGlobalTransforms(time, palette, lod);
+    this->applyInverseBind(palette, lod);
+}
+
+void SkeletalAnimator::
+computeBonePalette(const AnimationLayer* layers, size_t layerCount, glm::mat4* palette, const SkeletonLODLevel* lod) const {
+    ScratchScope scratch;
+    glm::quat* rotations = scratch.allocate<glm::quat>(this->skeleton->getBoneNum());
+    this->blendLayers(layers, layerCount, rotations, lod);
+    this->computeGlobalTransforms(rotations, palette, lod);
+    this->applyInverseBind(palette, lod);
+}
+
+void SkeletalAnimator::
+computeBonePalette(const glm::quat* rotations, glm::mat4* palette, const SkeletonLODLevel* lod) const {
+    this->computeGlobalTransforms(rotations, palette, lod);
+    this->applyInverseBind(palette, lod);
+}
@@ -0,0 +1,56 @@
+#include "skeletal/asset.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "gltf/tinygltf_helper.h"
+
+SkinnedAsset::
+SkinnedAsset(size_t _arenaBytes) :
+    arena(std::max<size_t>(_arenaBytes, 1)),
+    arenaBytes(_arenaBytes),
+    skel(&arena),
+    mesh(&arena),
+    anim(&arena) {
+}
+
+std::unique_ptr<SkinnedAsset> loadSkinnedAsset(
+    tinygltf::Model&& _model,
+    std::string& _warn,
+    std::string& _err,
+    bool _halfKeys
+) {
+    // take the model over, whatever happens it is freed on return
+    tinygltf::Model model = std::move(_model);
+    _model = tinygltf::Model();
+
+    auto asset = std::make_unique<SkinnedAsset>(Skeleton::estimateLoadBytes(model) +
+        BoneWeightedMesh::estimateLoadBytes(model) + SkeletalAnimator::estimateLoadBytes(model, _halfKeys));
+    if (!asset->skel.loadFromTinyGLTF(model, _warn, _err)) {
+        _err = "Skeleton: " + _err;
+        return nullptr;
+    }
+    if (!asset->mesh.loadFromTinyGLTF(model, _warn, _err)) {
+        _err = "Mesh: " + _err;
+        return nullptr;
+    }
+    if (!asset->anim.loadFromTinyGLTF(model, _warn, _err, &asset->skel, _halfKeys)) {
+        _err = "Animation: " + _err;
+        return nullptr;
+    }
+    return asset;
+}
+
+std::unique_ptr<SkinnedAsset> loadSkinnedAsset(
+    const std::string& _path,
+    std::string& _warn,
+    std::string& _err,
+    bool _halfKeys
+) {
+    tinygltf::Model model;
+    if (!tinygltf_parsefile(_path, model)) {
+        _err = "Failed to parse " + _path;
+        return nullptr;
+    }
+    return loadSkinnedAsset(std::move(model), _warn, _err, _halfKeys);
+}
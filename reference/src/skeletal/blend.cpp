@@ -0,0 +1,46 @@
+#include "skeletal/blend.hpp"
+
+// mask over the joints flagged in `_included`, listed in evaluation order
+static JointMask
+buildMask(const Skeleton& _skel, std::vector<unsigned char> _included) {
+    JointMask mask;
+    for (int j_id : _skel.getEvalOrder()) {
+        if (_included[j_id])
+            mask.joints.push_back(j_id);
+    }
+    mask.included = std::move(_included);
+    return mask;
+}
+
+JointMask JointMask::
+subtree(const Skeleton& _skel, int _root) {
+    const auto& joints = _skel.getJoints();
+    std::vector<unsigned char> included(joints.size(), 0);
+    if (_root >= 0 && _root < static_cast<int>(joints.size())) {
+        // parents come first, so a joint's parent is decided before the joint
+        included[_root] = 1;
+        for (int j_id : _skel.getEvalOrder()) {
+            if (joints[j_id].Parent != -1 && included[joints[j_id].Parent])
+                included[j_id] = 1;
+        }
+    }
+    return buildMask(_skel, std::move(included));
+}
+
+JointMask JointMask::
+fromJoints(const Skeleton& _skel, const std::vector<int>& _joints) {
+    std::vector<unsigned char> included(_skel.getBoneNum(), 0);
+    for (int j_id : _joints) {
+        if (j_id >= 0 && j_id < static_cast<int>(included.size()))
+            included[j_id] = 1;
+    }
+    return buildMask(_skel, std::move(included));
+}
+
+JointMask JointMask::
+inverted(const Skeleton& _skel) const {
+    std::vector<unsigned char> flipped(this->included.size());
+    for (size_t j = 0; j < flipped.size(); ++j)
+        flipped[j] = !this->included[j];
+    return buildMask(_skel, std::move(flipped));
+}
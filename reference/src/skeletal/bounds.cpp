@@ -0,0 +1,81 @@
+#include "skeletal/bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void SkinnedBounds::
+build(const BoneWeightedMesh& _mesh, size_t _boneCount, float _minWeight) {
+    // center: middle of the joint's influence box
+    std::vector<glm::vec3> boxMin(_boneCount, glm::vec3(std::numeric_limits<float>::max()));
+    std::vector<glm::vec3> boxMax(_boneCount, glm::vec3(-std::numeric_limits<float>::max()));
+    std::vector<bool> used(_boneCount, false);
+
+    for (size_t v = 0; v < _mesh.positions.size(); ++v) {
+        for (int k = 0; k < 4; ++k) {
+            unsigned int j = _mesh.influences[v][k];
+            if (_mesh.weights[v][k] <= _minWeight || j >= _boneCount)
+                continue;
+            boxMin[j] = glm::min(boxMin[j], _mesh.positions[v]);
+            boxMax[j] = glm::max(boxMax[j], _mesh.positions[v]);
+            used[j] = true;
+        }
+    }
+
+    this->jointSpheres.assign(_boneCount, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+    for (size_t j = 0; j < _boneCount; ++j) {
+        if (used[j])
+            this->jointSpheres[j] = glm::vec4(0.5f * (boxMin[j] + boxMax[j]), 0.0f);
+    }
+
+    // radius: farthest influenced vertex
+    for (size_t v = 0; v < _mesh.positions.size(); ++v) {
+        for (int k = 0; k < 4; ++k) {
+            unsigned int j = _mesh.influences[v][k];
+            if (_mesh.weights[v][k] <= _minWeight || j >= _boneCount)
+                continue;
+            glm::vec4& sphere = this->jointSpheres[j];
+            sphere.w = std::max(sphere.w, glm::length(_mesh.positions[v] - glm::vec3(sphere)));
+        }
+    }
+}
+
+glm::vec4 SkinnedBounds::
+computeBound(const glm::mat4* _palette) const {
+    // box around the posed joint spheres first
+    glm::vec3 boxMin(std::numeric_limits<float>::max());
+    glm::vec3 boxMax(-std::numeric_limits<float>::max());
+    bool empty = true;
+    for (size_t j = 0; j < this->jointSpheres.size(); ++j) {
+        if (this->jointSpheres[j].w < 0.0f)
+            continue;
+        glm::vec4 sphere = transformSphere(_palette[j], this->jointSpheres[j]);
+        boxMin = glm::min(boxMin, glm::vec3(sphere) - glm::vec3(sphere.w));
+        boxMax = glm::max(boxMax, glm::vec3(sphere) + glm::vec3(sphere.w));
+        empty = false;
+    }
+    if (empty)
+        return glm::vec4(0.0f);
+
+    // then a sphere around the box center enclosing every posed sphere,
+    // transforming again is cheaper than keeping them around
+    glm::vec3 center = 0.5f * (boxMin + boxMax);
+    float radius = 0.0f;
+    for (size_t j = 0; j < this->jointSpheres.size(); ++j) {
+        if (this->jointSpheres[j].w < 0.0f)
+            continue;
+        glm::vec4 sphere = transformSphere(_palette[j], this->jointSpheres[j]);
+        radius = std::max(radius, glm::length(glm::vec3(sphere) - center) + sphere.w);
+    }
+    return glm::vec4(center, radius);
+}
+
+glm::vec4 transformSphere(const glm::mat4& _transform, const glm::vec4& _sphere) {
+    glm::vec3 center = glm::vec3(_transform * glm::vec4(glm::vec3(_sphere), 1.0f));
+    float scale = std::sqrt(std::max({
+        glm::dot(glm::vec3(_transform[0]), glm::vec3(_transform[0])),
+        glm::dot(glm::vec3(_transform[1]), glm::vec3(_transform[1])),
+        glm::dot(glm::vec3(_transform[2]), glm::vec3(_transform[2]))
+    }));
+    return glm::vec4(center, _sphere.w * scale);
+}
@@ -0,0 +1,347 @@
+#include "skeletal/graph.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+#include "memory/scratch.hpp"
+#include "profile/profiler.hpp"
+
+static void
+parseTree(const nlohmann::json& _json, BlendTreeNodeDesc& _node) {
+    if (_json.contains("clip")) {
+        const nlohmann::json& clip = _json["clip"];
+        _node.clip = clip.is_number() ? std::to_string(clip.get<int>()) : clip.get<std::string>();
+    }
+    _node.parameter = _json.value("parameter", std::string());
+    _node.thresholds = _json.value("thresholds", std::vector<float>());
+    if (_json.contains("children")) {
+        for (const nlohmann::json& child : _json["children"]) {
+            _node.children.emplace_back();
+            parseTree(child, _node.children.back());
+        }
+    }
+}
+
+bool AnimationGraphDesc::
+loadFromJson(const std::string& _path, std::string& _err) {
+    std::ifstream in(_path);
+    if (!in) {
+        _err = "Cannot open " + _path;
+        return false;
+    }
+    nlohmann::json doc = nlohmann::json::parse(in, nullptr, false);
+    if (doc.is_discarded()) {
+        _err = _path + " is not valid JSON";
+        return false;
+    }
+
+    try {
+        this->parameters = doc.value("parameters", std::vector<std::string>());
+        this->initial = doc.value("initial", std::string());
+        for (const nlohmann::json& state : doc.at("states")) {
+            AnimationStateDesc desc;
+            desc.name = state.at("name").get<std::string>();
+            desc.speed = state.value("speed", 1.0f);
+            desc.loop = state.value("loop", true);
+            parseTree(state.at("tree"), desc.tree);
+            this->states.push_back(std::move(desc));
+        }
+        if (doc.contains("transitions")) {
+            for (const nlohmann::json& transition : doc["transitions"]) {
+                AnimationTransitionDesc desc;
+                desc.from = transition.value("from", std::string("*"));
+                desc.to = transition.at("to").get<std::string>();
+                desc.parameter = transition.at("parameter").get<std::string>();
+                desc.above = transition.contains("above");
+                desc.threshold = transition.at(desc.above ? "above" : "below").get<float>();
+                desc.duration = transition.value("duration", 0.2f);
+                this->transitions.push_back(std::move(desc));
+            }
+        }
+    } catch (const nlohmann::json::exception& e) {
+        _err = _path + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+int AnimationGraph::
+findParameter(const std::string& _name) const {
+    auto it = std::find(this->parameterNames.begin(), this->parameterNames.end(), _name);
+    return it == this->parameterNames.end() ? -1 : static_cast<int>(it - this->parameterNames.begin());
+}
+
+bool AnimationGraph::
+compileTree(const BlendTreeNodeDesc& _root, int _state, std::string& _err) {
+    // breadth first, so every node's children are appended next to each other
+    std::deque<std::pair<const BlendTreeNodeDesc*, int>> pending;
+    this->nodes.push_back({ _state });
+    pending.push_back({ &_root, static_cast<int>(this->nodes.size()) - 1 });
+
+    while (!pending.empty()) {
+        auto [desc, index] = pending.front();
+        pending.pop_front();
+
+        if (desc->children.empty()) {
+            int clip = this->animator->findClip(desc->clip);
+            if (clip == -1 && !desc->clip.empty() && std::all_of(desc->clip.begin(), desc->clip.end(), [](unsigned char c) { return std::isdigit(c); }))
+                clip = std::stoi(desc->clip);
+            if (clip < 0 || clip >= static_cast<int>(this->animator->getClipCount())) {
+                _err = "No clip \"" + desc->clip + "\"";
+                return false;
+            }
+            this->nodes[index].clip = clip;
+            this->leaves.push_back(index);
+            continue;
+        }
+
+        int parameter = this->findParameter(desc->parameter);
+        if (parameter == -1) {
+            _err = "Blend node driven by unknown parameter \"" + desc->parameter + "\"";
+            return false;
+        }
+        if (desc->thresholds.size() != desc->children.size() ||
+            !std::is_sorted(desc->thresholds.begin(), desc->thresholds.end())) {
+            _err = "Blend node on \"" + desc->parameter + "\" needs one increasing threshold per child";
+            return false;
+        }
+        Node& node = this->nodes[index];
+        node.parameter = parameter;
+        node.firstChild = static_cast<int>(this->nodes.size());
+        node.childCount = static_cast<int>(desc->children.size());
+        node.firstThreshold = static_cast<int>(this->thresholds.size());
+        this->thresholds.insert(this->thresholds.end(), desc->thresholds.begin(), desc->thresholds.end());
+        for (const BlendTreeNodeDesc& child : desc->children) {
+            this->nodes.push_back({ _state });
+            pending.push_back({ &child, static_cast<int>(this->nodes.size()) - 1 });
+        }
+    }
+    return true;
+}
+
+bool AnimationGraph::
+compile(const AnimationGraphDesc& _desc, const SkeletalAnimator* _animator, std::string& _err) {
+    *this = AnimationGraph();
+    this->animator = _animator;
+    this->parameterNames = _desc.parameters;
+    if (_desc.states.empty()) {
+        _err = "Animation graph without states";
+        return false;
+    }
+
+    auto findState = [&_desc](const std::string& _name) {
+        for (size_t s = 0; s < _desc.states.size(); ++s) {
+            if (_desc.states[s].name == _name)
+                return static_cast<int>(s);
+        }
+        return -1;
+    };
+
+    for (size_t s = 0; s < _desc.states.size(); ++s) {
+        const AnimationStateDesc& desc = _desc.states[s];
+        State state;
+        state.root = static_cast<int>(this->nodes.size());
+        state.firstLeaf = static_cast<int>(this->leaves.size());
+        state.speed = desc.speed;
+        state.loop = desc.loop;
+        if (!this->compileTree(desc.tree, static_cast<int>(s), _err)) {
+            _err = "State \"" + desc.name + "\": " + _err;
+            return false;
+        }
+        state.leafCount = static_cast<int>(this->leaves.size()) - state.firstLeaf;
+        this->states.push_back(state);
+    }
+
+    for (const AnimationTransitionDesc& desc : _desc.transitions) {
+        Transition transition;
+        transition.from = desc.from == "*" ? -1 : findState(desc.from);
+        transition.to = findState(desc.to);
+        transition.parameter = this->findParameter(desc.parameter);
+        transition.above = desc.above;
+        transition.threshold = desc.threshold;
+        transition.duration = desc.duration;
+        if ((desc.from != "*" && transition.from == -1) || transition.to == -1 || transition.parameter == -1) {
+            _err = "Transition " + desc.from + " -> " + desc.to + " refers to an unknown state or parameter";
+            return false;
+        }
+        this->transitions.push_back(transition);
+    }
+
+    this->initialState = _desc.initial.empty() ? 0 : findState(_desc.initial);
+    if (this->initialState == -1) {
+        _err = "No initial state \"" + _desc.initial + "\"";
+        return false;
+    }
+    return true;
+}
+
+void AnimationGraph::
+initInstances(AnimationGraphInstances& _instances, size_t _count) const {
+    _instances.count = _count;
+    _instances.parameterCount = this->parameterNames.size();
+    _instances.parameters.assign(_count * _instances.parameterCount, 0.0f);
+    _instances.state.assign(_count, this->initialState);
+    _instances.phase.assign(_count, 0.0f);
+    _instances.previousState.assign(_count, -1);
+    _instances.previousPhase.assign(_count, 0.0f);
+    _instances.fade.assign(_count, 0.0f);
+    _instances.fadeDuration.assign(_count, 0.0f);
+}
+
+void AnimationGraph::
+fireTransitions(AnimationGraphInstances& _instances) const {
+    // at most one transition per instance and frame
+    ScratchScope scratch;
+    unsigned char* fired = scratch.allocate<unsigned char>(_instances.count);
+    std::fill(fired, fired + _instances.count, 0);
+
+    for (const Transition& transition : this->transitions) {
+        for (size_t i = 0; i < _instances.count; ++i) {
+            int state = _instances.state[i];
+            if (fired[i] || state == transition.to || (transition.from != -1 && state != transition.from))
+                continue;
+            float value = _instances.parameter(i, transition.parameter);
+            if (transition.above ? value <= transition.threshold : value >= transition.threshold)
+                continue;
+            _instances.previousState[i] = state;
+            _instances.previousPhase[i] = _instances.phase[i];
+            _instances.state[i] = transition.to;
+            _instances.phase[i] = 0.0f;
+            _instances.fade[i] = 0.0f;
+            _instances.fadeDuration[i] = transition.duration;
+            fired[i] = 1;
+        }
+    }
+}
+
+void AnimationGraph::
+computeNodeWeights(const AnimationGraphInstances& _instances, float* _weights) const {
+    const size_t count = _instances.count;
+    std::fill(_weights, _weights + this->nodes.size() * count, 0.0f);
+    for (size_t s = 0; s < this->states.size(); ++s) {
+        float* root = &_weights[this->states[s].root * count];
+        for (size_t i = 0; i < count; ++i)
+            root[i] = _instances.state[i] == static_cast<int>(s) || _instances.previousState[i] == static_cast<int>(s) ? 1.0f : 0.0f;
+    }
+
+    // parents come first, a node's weight is final before its children are visited
+    for (const Node& node : this->nodes) {
+        if (node.childCount == 0)
+            continue;
+        const float* weights = &_weights[(&node - this->nodes.data()) * count];
+        const float* threshold = &this->thresholds[node.firstThreshold];
+        int last = node.childCount - 1;
+        for (size_t i = 0; i < count; ++i) {
+            float weight = weights[i];
+            if (weight == 0.0f)
+                continue;
+            float value = _instances.parameters[i * _instances.parameterCount + node.parameter];
+            int k = 0;
+            float t = 0.0f;
+            if (value >= threshold[last]) {
+                k = last;
+            } else if (value > threshold[0]) {
+                while (value >= threshold[k + 1])
+                    ++k;
+                t = (value - threshold[k]) / (threshold[k + 1] - threshold[k]);
+            }
+            _weights[(node.firstChild + k) * count + i] += weight * (1.0f - t);
+            if (t > 0.0f)
+                _weights[(node.firstChild + k + 1) * count + i] += weight * t;
+        }
+    }
+}
+
+void AnimationGraph::
+evaluate(AnimationGraphInstances& _instances, float _dt, glm::mat4* _palettes) const {
+    PROFILE_ZONE("graph");
+    const size_t count = _instances.count;
+    const size_t boneCount = this->animator->getSkeleton()->getBoneNum();
+    const auto& joints = this->animator->getSkeleton()->getJoints();
+
+    this->fireTransitions(_instances);
+
+    ScratchScope scratch;
+    float* weights = scratch.allocate<float>(this->nodes.size() * count);
+    this->computeNodeWeights(_instances, weights);
+
+    // playback speed of each active state: its clips' durations blended by weight,
+    // then both phases advance and cross-fades progress
+    float* duration = scratch.allocate<float>(count);
+    float* previousDuration = scratch.allocate<float>(count);
+    std::fill(duration, duration + count, 0.0f);
+    std::fill(previousDuration, previousDuration + count, 0.0f);
+    for (int leaf : this->leaves) {
+        const Node& node = this->nodes[leaf];
+        float clipDuration = this->animator->getDuration(node.clip);
+        const float* leafWeights = &weights[leaf * count];
+        for (size_t i = 0; i < count; ++i) {
+            if (_instances.state[i] == node.state)
+                duration[i] += leafWeights[i] * clipDuration;
+            else if (_instances.previousState[i] == node.state)
+                previousDuration[i] += leafWeights[i] * clipDuration;
+        }
+    }
+    auto advancePhase = [this, _dt](int _state, float _duration, float& _phase) {
+        const State& state = this->states[_state];
+        if (_duration <= 0.0f)
+            return;
+        _phase += _dt * state.speed / _duration;
+        _phase = state.loop ? _phase - std::floor(_phase) : std::min(_phase, 1.0f);
+    };
+    float* fadeIn = scratch.allocate<float>(count);
+    for (size_t i = 0; i < count; ++i) {
+        advancePhase(_instances.state[i], duration[i], _instances.phase[i]);
+        fadeIn[i] = 1.0f;
+        if (_instances.previousState[i] == -1)
+            continue;
+        advancePhase(_instances.previousState[i], previousDuration[i], _instances.previousPhase[i]);
+        _instances.fade[i] += _dt;
+        if (_instances.fade[i] >= _instances.fadeDuration[i])
+            _instances.previousState[i] = -1;
+        else
+            fadeIn[i] = _instances.fade[i] / _instances.fadeDuration[i];
+    }
+
+    // every clip the program plays, sampled for all instances that weigh it,
+    // summed into a per-instance pose (quaternions kept in one hemisphere)
+    glm::quat* poses = scratch.allocate<glm::quat>(count * boneCount);
+    glm::quat* sampled = scratch.allocate<glm::quat>(boneCount);
+    std::fill(poses, poses + count * boneCount, glm::quat(0.0f, 0.0f, 0.0f, 0.0f));
+    for (int leaf : this->leaves) {
+        const Node& node = this->nodes[leaf];
+        float clipDuration = this->animator->getDuration(node.clip);
+        const float* leafWeights = &weights[leaf * count];
+        for (size_t i = 0; i < count; ++i) {
+            bool current = _instances.state[i] == node.state;
+            if (!current && _instances.previousState[i] != node.state)
+                continue;
+            float weight = leafWeights[i] * (current ? fadeIn[i] : 1.0f - fadeIn[i]);
+            if (weight <= 0.0f)
+                continue;
+            float phase = current ? _instances.phase[i] : _instances.previousPhase[i];
+            this->animator->sampleClip(node.clip, phase * clipDuration, sampled);
+
+            glm::quat* pose = &poses[i * boneCount];
+            for (size_t j = 0; j < boneCount; ++j) {
+                glm::quat q = glm::dot(pose[j], sampled[j]) < 0.0f ? -sampled[j] : sampled[j];
+                pose[j] = pose[j] + weight * q;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        glm::quat* pose = &poses[i * boneCount];
+        for (size_t j = 0; j < boneCount; ++j) {
+            float length = glm::length(pose[j]);
+            pose[j] = length > 1e-6f ? pose[j] / length : joints[j].baseQuaternion;
+        }
+        this->animator->computeBonePalette(pose, &_palettes[i * boneCount]);
+    }
+}
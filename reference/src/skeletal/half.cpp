@@ -0,0 +1,210 @@
+#include "skeletal/half.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+
+// F16C is only used in the functions marked HALF_TARGET_F16C and only
+// after checking the CPU, everything else builds for the baseline target
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <immintrin.h>
+    #define HALF_HAS_F16C_PATH
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define HALF_TARGET_F16C
+    #else
+        #define HALF_TARGET_F16C __attribute__((target("avx,f16c")))
+    #endif
+#endif
+
+namespace {
+#ifdef HALF_HAS_F16C_PATH
+    bool detectF16C() {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        // AVX registers must also be saved by the OS (OSXSAVE, then XCR0)
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool f16c = (info[2] & (1 << 29)) != 0;
+        return osxsave && avx && f16c && (_xgetbv(0) & 0x6) == 0x6;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    #endif
+    }
+
+    // checked once at startup, conversions before that take the scalar path
+    const bool hasF16C = detectF16C();
+
+    // convert the leading multiple of 8 values, return how many
+    HALF_TARGET_F16C size_t packHalvesF16C(const float* _values, uint16_t* _halves, size_t _count) {
+        size_t i = 0;
+        for (; i + 8 <= _count; i += 8) {
+            __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(_values + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(_halves + i), halves);
+        }
+        return i;
+    }
+
+    HALF_TARGET_F16C size_t unpackHalvesF16C(const uint16_t* _halves, float* _values, size_t _count) {
+        size_t i = 0;
+        for (; i + 8 <= _count; i += 8) {
+            __m256 values = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(_halves + i)));
+            _mm256_storeu_ps(_values + i, values);
+        }
+        return i;
+    }
+
+    HALF_TARGET_F16C void unpackHalves4F16C(const uint16_t* _halves, float* _values) {
+        _mm_storeu_ps(_values, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(_halves))));
+    }
+#endif
+}
+
+uint16_t floatToHalf(float _value) {
+    uint32_t bits;
+    memcpy(&bits, &_value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    if (magnitude >= 0x7F800000) // infinity, or a quiet NaN keeping the top of its payload
+        return static_cast<uint16_t>(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 | ((magnitude >> 13) & 0x3FF) : 0));
+    if (magnitude >= 0x47800000) // 65536 and above, out of range
+        return static_cast<uint16_t>(sign | 0x7C00);
+
+    uint32_t half, rest, halfway;
+    if (magnitude < 0x38800000) {
+        // below 2^-14, a denormal half: the mantissa with its implicit bit in units of 2^-24
+        int shift = 126 - static_cast<int>(magnitude >> 23);
+        if (shift > 24)
+            return static_cast<uint16_t>(sign);
+        uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        // rebias the exponent from 127 to 15, drop 13 mantissa bits
+        half = (magnitude - 0x38000000) >> 13;
+        rest = magnitude & 0x1FFF;
+        halfway = 0x1000;
+    }
+    // round to nearest even, a carry into the exponent is still correct
+    if (rest > halfway || (rest == halfway && (half & 1)))
+        ++half;
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t _half) {
+    uint32_t sign = (_half & 0x8000u) << 16;
+    uint32_t exponent = (_half >> 10) & 0x1F;
+    uint32_t mantissa = _half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        // NaNs come out quiet, like F16C
+        bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void packHalves(const float* _values, uint16_t* _halves, size_t _count) {
+    size_t i = 0;
+#ifdef HALF_HAS_F16C_PATH
+    if (hasF16C)
+        i = packHalvesF16C(_values, _halves, _count);
+#endif
+    for (; i < _count; ++i)
+        _halves[i] = floatToHalf(_values[i]);
+}
+
+void unpackHalves(const uint16_t* _halves, float* _values, size_t _count) {
+    size_t i = 0;
+#ifdef HALF_HAS_F16C_PATH
+    if (hasF16C)
+        i = unpackHalvesF16C(_halves, _values, _count);
+#endif
+    for (; i < _count; ++i)
+        _values[i] = halfToFloat(_halves[i]);
+}
+
+void packPalette(const glm::mat4* _palette, size_t _count, HalfMat4* _halves) {
+    static_assert(sizeof(glm::mat4) == 16 * sizeof(float) && sizeof(HalfMat4) == 16 * sizeof(uint16_t), "palettes must be tightly packed");
+    packHalves(&_palette[0][0][0], _halves[0].m, 16 * _count);
+}
+
+HalfQuat packQuat(const glm::quat& _rotation) {
+    return { { floatToHalf(_rotation.x), floatToHalf(_rotation.y), floatToHalf(_rotation.z), floatToHalf(_rotation.w) } };
+}
+
+glm::quat unpackQuat(const HalfQuat& _rotation) {
+#ifdef HALF_HAS_F16C_PATH
+    // the sampler's inner loop, one conversion for the four components
+    if (hasF16C) {
+        float xyzw[4];
+        unpackHalves4F16C(_rotation.xyzw, xyzw);
+        return glm::quat(xyzw[3], xyzw[0], xyzw[1], xyzw[2]);
+    }
+#endif
+    return glm::quat(halfToFloat(_rotation.xyzw[3]), halfToFloat(_rotation.xyzw[0]), 
+                     halfToFloat(_rotation.xyzw[1]), halfToFloat(_rotation.xyzw[2]));
+}
+
+void HalfPrecisionError::
+add(float _value, float _stored) {
+    float difference = std::abs(_stored - _value);
+    this->maxAbsolute = std::max(this->maxAbsolute, difference);
+    this->meanAbsolute += difference;
+    ++this->count;
+}
+
+void HalfPrecisionError::
+addRotation(const glm::quat& _rotation, const glm::quat& _stored) {
+    for (int c = 0; c < 4; ++c)
+        this->add(_rotation[c], _stored[c]);
+    // halves are not unit length, compare directions
+    float cosine = std::abs(glm::dot(glm::normalize(_rotation), glm::normalize(_stored)));
+    this->maxAngle = std::max(this->maxAngle, 2.0f * std::acos(std::min(cosine, 1.0f)));
+}
+
+void HalfPrecisionError::
+finish() {
+    if (this->count > 0)
+        this->meanAbsolute /= static_cast<float>(this->count);
+}
+
+HalfPrecisionError measurePaletteError(const glm::mat4* _palette, size_t _count) {
+    HalfPrecisionError error;
+    uint16_t halves[16];
+    float stored[16];
+    for (size_t j = 0; j < _count; ++j) {
+        const float* values = &_palette[j][0][0];
+        packHalves(values, halves, 16);
+        unpackHalves(halves, stored, 16);
+        for (int c = 0; c < 16; ++c)
+            error.add(values[c], stored[c]);
+    }
+    error.finish();
+    return error;
+}
+
+std::ostream& operator<<(std::ostream& _out, const HalfPrecisionError& _error) {
+    auto flags = _out.flags();
+    auto precision = _out.precision();
+    _out << std::setprecision(2) << std::scientific
+         << "max " << _error.maxAbsolute << ", mean " << _error.meanAbsolute;
+    if (_error.maxAngle > 0.0f)
+        _out << std::fixed << ", max angle " << glm::degrees(_error.maxAngle) << " deg";
+    _out << " over " << _error.count << " values";
+    _out.flags(flags);
+    _out.precision(precision);
+    return _out;
+}
@@ -0,0 +1,113 @@
+#include "skeletal/incremental.hpp"
+
+#include <algorithm>
+#include <span>
+
+#include "skeletal/lod.hpp"
+#include "memory/scratch.hpp"
+
+IncrementalPose::
+IncrementalPose(const SkeletalAnimator* _animator) : animator(_animator) {
+    size_t jointCount = _animator->getSkeleton()->getJoints().size();
+    this->rotations.resize(jointCount, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    this->globals.resize(jointCount, glm::mat4(1.0f));
+    this->palette.resize(jointCount, glm::mat4(1.0f));
+    this->dirty.resize(jointCount, 0);
+    this->moving.reserve(jointCount);
+}
+
+bool IncrementalPose::
+beginFull(const SkeletonLODLevel* _lod) {
+    if (this->valid && _lod == this->lod)
+        return false;
+    // skipped joints of the previous level may be evaluated in this one
+    std::fill(this->dirty.begin(), this->dirty.end(), 1);
+    this->lod = _lod;
+    this->valid = true;
+    return true;
+}
+
+void IncrementalPose::
+update(int _clip, float _time, const SkeletonLODLevel* _lod) {
+    const Skeleton* skel = this->animator->getSkeleton();
+    std::span<const int> evalOrder = _lod ? std::span<const int>(_lod->evalOrder) : std::span<const int>(skel->getEvalOrder());
+
+    bool full = this->beginFull(_lod);
+    if (full || _clip != this->clip) {
+        // constant tracks are sampled once here, then only the moving ones
+        const auto& constant = this->animator->getClip(_clip).constant;
+        this->moving.clear();
+        for (int j_id : evalOrder) {
+            if (!constant[j_id])
+                this->moving.push_back(j_id);
+        }
+        this->clip = _clip;
+        std::fill(this->dirty.begin(), this->dirty.end(), 1);
+        this->animator->sampleClip(_clip, _time, this->rotations.data(), _lod);
+        this->solve(_lod);
+        return;
+    }
+
+    ScratchScope scope;
+    glm::quat* sampled = scope.allocate<glm::quat>(this->rotations.size());
+    this->animator->sampleClip(_clip, _time, this->moving.data(), this->moving.size(), sampled);
+    for (int j_id : this->moving) {
+        if (sampled[j_id] != this->rotations[j_id]) {
+            this->rotations[j_id] = sampled[j_id];
+            this->dirty[j_id] = 1;
+        }
+    }
+    this->solve(_lod);
+}
+
+void IncrementalPose::
+update(const glm::quat* _rotations, const SkeletonLODLevel* _lod) {
+    const Skeleton* skel = this->animator->getSkeleton();
+    std::span<const int> evalOrder = _lod ? std::span<const int>(_lod->evalOrder) : std::span<const int>(skel->getEvalOrder());
+
+    // rotations from elsewhere, `moving` no longer describes them
+    this->clip = -1;
+    this->beginFull(_lod);
+    for (int j_id : evalOrder) {
+        if (this->dirty[j_id] || _rotations[j_id] != this->rotations[j_id]) {
+            this->rotations[j_id] = _rotations[j_id];
+            this->dirty[j_id] = 1;
+        }
+    }
+    this->solve(_lod);
+}
+
+void IncrementalPose::
+solve(const SkeletonLODLevel* _lod) {
+    const Skeleton* skel = this->animator->getSkeleton();
+    const auto& joints = skel->getJoints();
+    const auto& inverseBind = skel->getInverseBindMatrices();
+    std::span<const int> evalOrder = _lod ? std::span<const int>(_lod->evalOrder) : std::span<const int>(skel->getEvalOrder());
+
+    // parents come first, so a dirty parent has already been seen
+    this->dirtyCount = 0;
+    for (int j_id : evalOrder) {
+        int parent = joints[j_id].Parent;
+        if (parent != -1 && this->dirty[parent])
+            this->dirty[j_id] = 1;
+        if (!this->dirty[j_id])
+            continue;
+
+        glm::mat4 local = skel->getLocalTransform(j_id, this->rotations[j_id]);
+        this->globals[j_id] = parent == -1 ? local : this->globals[parent] * local;
+        this->palette[j_id] = this->globals[j_id] * inverseBind[j_id];
+        ++this->dirtyCount;
+    }
+
+    if (_lod) {
+        for (int j_id : _lod->skipped) {
+            int proxy = _lod->proxy[j_id];
+            if (!this->dirty[proxy] && !this->dirty[j_id])
+                continue;
+            this->globals[j_id] = this->globals[proxy] * _lod->proxyOffset[j_id];
+            this->palette[j_id] = this->palette[proxy];
+        }
+    }
+
+    std::fill(this->dirty.begin(), this->dirty.end(), 0);
+}
@@ -0,0 +1,188 @@
+#include "skeletal/lod.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    // not assigned yet, forces the first update
+    const unsigned char unassignedLevel = 0xFF;
+}
+
+float
+projectedSphereSize(const glm::vec4& _worldSphere, const FirstPersonCamera::FrameConstants& _frame) {
+    // projection[1][1] is 1 / tan(fov / 2)
+    float distance = std::max(glm::length(glm::vec3(_worldSphere) - glm::vec3(_frame.camPos)), 1e-4f);
+    return _worldSphere.w * _frame.projection[1][1] / distance;
+}
+
+AnimationLODScheduler::
+AnimationLODScheduler(size_t _instanceCount) {
+    this->resize(_instanceCount);
+}
+
+void AnimationLODScheduler::
+resize(size_t _instanceCount) {
+    this->levels.resize(_instanceCount, unassignedLevel);
+    this->phases.resize(_instanceCount, 0);
+}
+
+void AnimationLODScheduler::
+setThresholds(float _level1, float _level2, float _level3) {
+    this->thresholds[0] = _level1;
+    this->thresholds[1] = _level2;
+    this->thresholds[2] = _level3;
+}
+
+int AnimationLODScheduler::
+chooseLevel(size_t _instance, float _screenSize) const {
+    int current = this->levels[_instance];
+    int level = 0;
+    while (level < ANIMATION_LOD_LEVELS - 1) {
+        // stick to the current level near its boundaries
+        float threshold = this->thresholds[level];
+        if (current != unassignedLevel)
+            threshold *= level < current ? 1.0f + this->hysteresis : 1.0f - this->hysteresis;
+        if (_screenSize >= threshold)
+            break;
+        ++level;
+    }
+    return level;
+}
+
+bool AnimationLODScheduler::
+shouldUpdate(size_t _instance, const glm::vec4& _worldSphere, const FirstPersonCamera::FrameConstants& _frame) {
+    float screenSize = projectedSphereSize(_worldSphere, _frame);
+
+    int level = this->chooseLevel(_instance, screenSize);
+    if (level != this->levels[_instance]) {
+        // next free phase of the new level, so its instances update on different frames
+        unsigned int interval = 1u << level;
+        this->levels[_instance] = static_cast<unsigned char>(level);
+        this->phases[_instance] = static_cast<unsigned char>(this->levelCounters[level]++ % interval);
+        return true;
+    }
+
+    unsigned int interval = 1u << level;
+    return (this->frame + this->phases[_instance]) % interval == 0;
+}
+
+SkeletonLOD::
+SkeletonLOD(const Skeleton* _skel) : skeleton(_skel) {
+    this->addLevel(std::vector<unsigned char>(_skel->getBoneNum(), 1));
+}
+
+int SkeletonLOD::
+addLevel(std::vector<unsigned char> _keep) {
+    const auto& joints = this->skeleton->getJoints();
+    const auto& order = this->skeleton->getEvalOrder();
+
+    // children before parents, so one pass propagates a kept joint up to the root
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const Joint& joint = joints[*it];
+        if (joint.Parent == -1)
+            _keep[*it] = 1;
+        else if (_keep[*it])
+            _keep[joint.Parent] = 1;
+    }
+
+    SkeletonLODLevel level;
+    level.evaluated = std::move(_keep);
+    level.proxy.resize(joints.size());
+    level.proxyOffset.assign(joints.size(), glm::mat4(1.0f));
+    const auto& inverseBind = this->skeleton->getInverseBindMatrices();
+    for (int j_id : order) {
+        if (level.evaluated[j_id]) {
+            level.proxy[j_id] = j_id;
+            level.evalOrder.push_back(j_id);
+        } else {
+            int proxy = level.proxy[joints[j_id].Parent];
+            level.proxy[j_id] = proxy;
+            level.proxyOffset[j_id] = inverseBind[proxy] * joints[j_id].invBindMatrix;
+            level.skipped.push_back(j_id);
+        }
+    }
+
+    this->levels.push_back(std::move(level));
+    return static_cast<int>(this->levels.size()) - 1;
+}
+
+int SkeletonLOD::
+addLevelFromJoints(const std::vector<int>& _joints) {
+    std::vector<unsigned char> keep(this->skeleton->getBoneNum(), 0);
+    for (int j_id : _joints) {
+        if (j_id >= 0 && j_id < static_cast<int>(keep.size()))
+            keep[j_id] = 1;
+    }
+    return this->addLevel(std::move(keep));
+}
+
+int SkeletonLOD::
+addLevelFromBoneLength(float _minLength) {
+    const auto& joints = this->skeleton->getJoints();
+    std::vector<unsigned char> keep(joints.size(), 0);
+    for (size_t j = 0; j < joints.size(); ++j) {
+        // `position` holds the joint's bind position in model space
+        if (joints[j].Parent != -1 && glm::length(joints[j].position - joints[joints[j].Parent].position) >= _minLength)
+            keep[j] = 1;
+    }
+    return this->addLevel(std::move(keep));
+}
+
+int SkeletonLOD::
+addLevelFromInfluence(const BoneWeightedMesh& _mesh, float _minShare) {
+    std::vector<float> footprint(this->skeleton->getBoneNum(), 0.0f);
+    float total = 0.0f;
+    for (size_t v = 0; v < _mesh.weights.size(); ++v) {
+        for (int k = 0; k < 4; ++k) {
+            unsigned int j = _mesh.influences[v][k];
+            if (j >= footprint.size())
+                continue;
+            footprint[j] += _mesh.weights[v][k];
+            total += _mesh.weights[v][k];
+        }
+    }
+
+    std::vector<unsigned char> keep(footprint.size(), 0);
+    for (size_t j = 0; j < footprint.size(); ++j) {
+        if (total > 0.0f && footprint[j] >= _minShare * total)
+            keep[j] = 1;
+    }
+    return this->addLevel(std::move(keep));
+}
+
+void SkeletonLOD::
+reweightMesh(int _level, const BoneWeightedMesh& _src, BoneWeightedMesh& _dst) const {
+    const SkeletonLODLevel& level = this->levels[_level];
+    _dst = _src;
+
+    for (size_t v = 0; v < _dst.influences.size(); ++v) {
+        glm::uvec4 influences(0u);
+        glm::vec4 weights(0.0f);
+        int used = 0;
+        for (int k = 0; k < 4; ++k) {
+            unsigned int j = _src.influences[v][k];
+            float w = _src.weights[v][k];
+            if (w <= 0.0f || j >= level.proxy.size())
+                continue;
+            unsigned int proxy = static_cast<unsigned int>(level.proxy[j]);
+            int slot = 0;
+            while (slot < used && influences[slot] != proxy)
+                ++slot;
+            if (slot == used) {
+                influences[slot] = proxy;
+                ++used;
+            }
+            weights[slot] += w;
+        }
+
+        // heaviest influence first, empty slots last
+        for (int a = 1; a < used; ++a) {
+            for (int b = a; b > 0 && weights[b] > weights[b - 1]; --b) {
+                std::swap(weights[b], weights[b - 1]);
+                std::swap(influences[b], influences[b - 1]);
+            }
+        }
+        _dst.influences[v] = influences;
+        _dst.weights[v] = weights;
+    }
+}
@@ -3,6 +3,40 @@
 #include <glad/glad.h>
 
 #include "gltf/tinygltf_helper.h"
+#include "profile/profiler.hpp"
+
+// total index and vertex counts over the primitives of the first mesh
+static void
+countElements(const tinygltf::Model& mdl, size_t& indexCount, size_t& vertexCount) {
+    indexCount = vertexCount = 0;
+    for (const tinygltf::Primitive& geom : mdl.meshes[0].primitives) {
+        if (geom.indices != -1)
+            indexCount += mdl.accessors[geom.indices].count;
+        int vID = tinygltf_findAccessor(geom, "POSITION");
+        if (vID != -1)
+            vertexCount += mdl.accessors[vID].count;
+    }
+}
+
+BoneWeightedMesh::
+BoneWeightedMesh(std::pmr::memory_resource* _resource) :
+    indices(_resource),
+    positions(_resource),
+    normals(_resource),
+    uvs(_resource),
+    influences(_resource),
+    weights(_resource) {
+}
+
+size_t BoneWeightedMesh::
+estimateLoadBytes(const tinygltf::Model& mdl) {
+    if (mdl.meshes.empty())
+        return 0;
+    size_t indexCount, vertexCount;
+    countElements(mdl, indexCount, vertexCount);
+    const size_t vertexSize = 2 * sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::uvec4) + sizeof(glm::vec4);
+    return indexCount * sizeof(unsigned int) + vertexCount * vertexSize;
+}
 
 bool BoneWeightedMesh::
 loadFromTinyGLTF(
@@ -10,6 +44,7 @@ loadFromTinyGLTF(
     std::string& warn, 
     std::string& err
 ) { 
+    PROFILE_ZONE("load: mesh");
     if (mdl.meshes.size() == 0) {
         err = "No meshes in file.";
         return false;
@@ -22,6 +57,17 @@ loadFromTinyGLTF(
         return false;
     }
 
+    // Size everything from the accessor counts up front, so each array is a
+    // single allocation instead of growing once per primitive
+    size_t indexCount, vertexCount;
+    countElements(mdl, indexCount, vertexCount);
+    this->indices.reserve(this->indices.size() + indexCount);
+    this->positions.reserve(this->positions.size() + vertexCount);
+    this->normals.reserve(this->normals.size() + vertexCount);
+    this->uvs.reserve(this->uvs.size() + vertexCount);
+    this->influences.reserve(this->influences.size() + vertexCount);
+    this->weights.reserve(this->weights.size() + vertexCount);
+
     bool flipUVY = false;
     for (size_t geomIndex = 0; geomIndex < meshData.primitives.size(); ++geomIndex) {
         const tinygltf::Primitive geom = mdl.meshes[0].primitives[geomIndex];
@@ -40,7 +86,8 @@ loadFromTinyGLTF(
         // for OpenGL vertex buffers - in other words, spelling out the vertex
         // data as a set of triangles.
         auto faceIndexer = tinygltf_buildDataGetter(mdl, geom.indices);
-        if (faceIndexer.elementSize != sizeof(GLshort)) {
+        if (faceIndexer.elementSize != sizeof(GLubyte) && faceIndexer.elementSize != sizeof(GLushort) && 
+            faceIndexer.elementSize != sizeof(GLuint)) {
             err = "Primitive indices are in a currently unsupported format. " \
                   "Consider changing your GLTF export settings, or else this loader " \
                   "must be augmented to support the provided format.";
@@ -76,7 +123,7 @@ loadFromTinyGLTF(
         tinygltf_DataGetter infGetter, wtGetter, vGetter, nGetter, uvGetter;
         
         infGetter = tinygltf_buildDataGetter(mdl, influenceID);
-            if (infGetter.elementSize != 4 * sizeof(GLubyte)) {
+        if (infGetter.elementSize != 4 * sizeof(GLubyte) && infGetter.elementSize != 4 * sizeof(GLushort)) {
             err = "Joint influences are in a currently unsupported format." \
                   "Consider changing your GLTF export settings, or else check for " \
                   "and support this format in your GLTF loader implementation.";
@@ -134,9 +181,18 @@ loadFromTinyGLTF(
         // This is the bit where we actually get to extracting our data.
         for (size_t i = 0; i < faceIndexer.len; ++i)
         {
-            // What vertex do we need to look at?
-            GLshort vertIndex;
-            memcpy(&vertIndex, &faceIndexer.data[i * faceIndexer.stride], sizeof(GLshort));
+            // What vertex do we need to look at? Indices are unsigned, 8 to 32 bits
+            GLuint vertIndex = 0;
+            const unsigned char* src = &faceIndexer.data[i * faceIndexer.stride];
+            if (faceIndexer.elementSize == sizeof(GLuint)) {
+                memcpy(&vertIndex, src, sizeof(GLuint));
+            } else if (faceIndexer.elementSize == sizeof(GLushort)) {
+                GLushort index16;
+                memcpy(&index16, src, sizeof(GLushort));
+                vertIndex = index16;
+            } else {
+                vertIndex = *src;
+            }
             this->indices[indiceOffset + i] = startIndex + vertIndex;
         }
 
@@ -145,12 +201,17 @@ loadFromTinyGLTF(
         // the ORDER of nodes in the skeleton definition, rather than the
         // IDENTIFIERS of those nodes.
         const tinygltf::Skin& skin = mdl.skins[0];
+        bool wideJoints = infGetter.elementSize == 4 * sizeof(GLushort); // rigs above 256 joints
         for (size_t i = 0; i < infGetter.len; ++i) {
-            unsigned char j0, j1, j2, j3; // these are index of `skin.joints`
-            memcpy(&j0, &infGetter.data[i * infGetter.stride + 0 * sizeof(GLubyte)], sizeof(GLubyte));
-            memcpy(&j1, &infGetter.data[i * infGetter.stride + 1 * sizeof(GLubyte)], sizeof(GLubyte));
-            memcpy(&j2, &infGetter.data[i * infGetter.stride + 2 * sizeof(GLubyte)], sizeof(GLubyte));
-            memcpy(&j3, &infGetter.data[i * infGetter.stride + 3 * sizeof(GLubyte)], sizeof(GLubyte));
+            unsigned int j0, j1, j2, j3; // these are index of `skin.joints`
+            if (wideJoints) {
+                GLushort j[4];
+                memcpy(j, &infGetter.data[i * infGetter.stride], sizeof(j));
+                j0 = j[0]; j1 = j[1]; j2 = j[2]; j3 = j[3];
+            } else {
+                const unsigned char* j = &infGetter.data[i * infGetter.stride];
+                j0 = j[0]; j1 = j[1]; j2 = j[2]; j3 = j[3];
+            }
             
             this->influences[startIndex + i] = glm::uvec4(
                 skin.joints[j0], 
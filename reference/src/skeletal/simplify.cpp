@@ -0,0 +1,293 @@
+#include "skeletal/simplify.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+namespace {
+    // symmetric 4x4 matrix of the plane quadric, upper triangle row by row
+    struct Quadric {
+        double q[10] = {};
+
+        void addPlane(const glm::dvec3& _n, double _d, double _weight) {
+            q[0] += _weight * _n.x * _n.x; q[1] += _weight * _n.x * _n.y; q[2] += _weight * _n.x * _n.z; q[3] += _weight * _n.x * _d;
+            q[4] += _weight * _n.y * _n.y; q[5] += _weight * _n.y * _n.z; q[6] += _weight * _n.y * _d;
+            q[7] += _weight * _n.z * _n.z; q[8] += _weight * _n.z * _d;
+            q[9] += _weight * _d * _d;
+        }
+
+        void add(const Quadric& _other) {
+            for (int i = 0; i < 10; ++i)
+                q[i] += _other.q[i];
+        }
+
+        double evaluate(const glm::vec3& _p) const {
+            double x = _p.x, y = _p.y, z = _p.z;
+            return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+                 + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+                 + q[7] * z * z + 2.0 * q[8] * z
+                 + q[9];
+        }
+    };
+
+    struct Collapse {
+        float cost;
+        unsigned int from, to;
+        unsigned int fromVersion, toVersion;
+
+        bool operator>(const Collapse& _other) const { return cost > _other.cost; }
+    };
+
+    // half the L1 distance between two skin weight vectors: 0 when skinned
+    // identically, 1 when no joint is shared
+    float skinDistance(const BoneWeightedMesh& _mesh, unsigned int _a, unsigned int _b) {
+        float shared = 0.0f, totalA = 0.0f, totalB = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+            totalA += _mesh.weights[_a][i];
+            totalB += _mesh.weights[_b][i];
+            for (int k = 0; k < 4; ++k) {
+                if (_mesh.influences[_a][i] == _mesh.influences[_b][k])
+                    shared += std::min(_mesh.weights[_a][i], _mesh.weights[_b][k]);
+            }
+        }
+        return std::max(0.0f, 0.5f * (totalA + totalB) - shared);
+    }
+}
+
+bool
+simplifySkinnedMesh(
+    const BoneWeightedMesh& _src,
+    size_t _targetTriangles,
+    float _skinWeight,
+    BoneWeightedMesh& _dst
+) {
+    const size_t vertexCount = _src.positions.size();
+    const size_t triangleCount = _src.indices.size() / 3;
+    const auto& pos = _src.positions;
+
+    std::vector<glm::uvec3> tris(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        tris[t] = glm::uvec3(_src.indices[3 * t], _src.indices[3 * t + 1], _src.indices[3 * t + 2]);
+    std::vector<bool> triAlive(triangleCount, true);
+
+    std::vector<std::vector<unsigned int>> vertexTris(vertexCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k)
+            vertexTris[tris[t][k]].push_back(static_cast<unsigned int>(t));
+    }
+
+    // seam vertices: same position as another vertex
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<unsigned int> byPosition(vertexCount);
+        std::iota(byPosition.begin(), byPosition.end(), 0u);
+        auto less = [&pos](unsigned int a, unsigned int b) {
+            if (pos[a].x != pos[b].x) return pos[a].x < pos[b].x;
+            if (pos[a].y != pos[b].y) return pos[a].y < pos[b].y;
+            return pos[a].z < pos[b].z;
+        };
+        std::sort(byPosition.begin(), byPosition.end(), less);
+        for (size_t i = 1; i < vertexCount; ++i) {
+            if (pos[byPosition[i]] == pos[byPosition[i - 1]])
+                locked[byPosition[i]] = locked[byPosition[i - 1]] = true;
+        }
+    }
+
+    // face quadrics weighted by area, border edges get a perpendicular plane
+    // so open borders do not shrink
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::pair<unsigned long long, unsigned int>> edges;
+    edges.reserve(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        glm::dvec3 p0(pos[tris[t][0]]), p1(pos[tris[t][1]]), p2(pos[tris[t][2]]);
+        glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        double area2 = glm::length(n);
+        if (area2 <= 0.0)
+            continue;
+        n /= area2;
+        for (int k = 0; k < 3; ++k)
+            quadrics[tris[t][k]].addPlane(n, -glm::dot(n, p0), 0.5 * area2);
+        for (int k = 0; k < 3; ++k) {
+            unsigned long long a = tris[t][k], b = tris[t][(k + 1) % 3];
+            edges.push_back({ std::min(a, b) << 32 | std::max(a, b), static_cast<unsigned int>(t) });
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        bool shared = (i > 0 && edges[i - 1].first == edges[i].first) ||
+                      (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+        if (shared)
+            continue;
+        unsigned int a = static_cast<unsigned int>(edges[i].first >> 32);
+        unsigned int b = static_cast<unsigned int>(edges[i].first & 0xFFFFFFFFu);
+        const glm::uvec3& tri = tris[edges[i].second];
+        glm::dvec3 faceNormal = glm::cross(glm::dvec3(pos[tri[1]]) - glm::dvec3(pos[tri[0]]), glm::dvec3(pos[tri[2]]) - glm::dvec3(pos[tri[0]]));
+        glm::dvec3 edge = glm::dvec3(pos[b]) - glm::dvec3(pos[a]);
+        glm::dvec3 n = glm::cross(edge, faceNormal);
+        double len = glm::length(n);
+        if (len <= 0.0)
+            continue;
+        n /= len;
+        double weight = 10.0 * glm::dot(edge, edge);
+        quadrics[a].addPlane(n, -glm::dot(n, glm::dvec3(pos[a])), weight);
+        quadrics[b].addPlane(n, -glm::dot(n, glm::dvec3(pos[a])), weight);
+    }
+
+    std::vector<unsigned int> versions(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    auto pushCollapse = [&](unsigned int from, unsigned int to) {
+        if (locked[from])
+            return;
+        Quadric q = quadrics[from];
+        q.add(quadrics[to]);
+        float edgeLength2 = glm::dot(pos[to] - pos[from], pos[to] - pos[from]);
+        float cost = static_cast<float>(q.evaluate(pos[to])) + _skinWeight * skinDistance(_src, from, to) * edgeLength2;
+        heap.push({ cost, from, to, versions[from], versions[to] });
+    };
+    for (const auto& edge : edges) {
+        unsigned int a = static_cast<unsigned int>(edge.first >> 32);
+        unsigned int b = static_cast<unsigned int>(edge.first & 0xFFFFFFFFu);
+        pushCollapse(a, b);
+        pushCollapse(b, a);
+    }
+
+    size_t aliveCount = triangleCount;
+    std::vector<unsigned int> neighbours;
+    while (aliveCount > _targetTriangles && !heap.empty()) {
+        Collapse c = heap.top();
+        heap.pop();
+        if (c.fromVersion != versions[c.from] || c.toVersion != versions[c.to])
+            continue;
+
+        // reject collapses that flip a face around `from`; dead faces stay
+        // listed at their other vertices and are skipped here and below
+        bool flips = false;
+        for (unsigned int t : vertexTris[c.from]) {
+            if (!triAlive[t])
+                continue;
+            const glm::uvec3& tri = tris[t];
+            if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+                continue;
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = pos[tri[k]];
+                q[k] = tri[k] == c.from ? pos[c.to] : p[k];
+            }
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(before, after) <= 0.0f) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips)
+            continue;
+
+        for (unsigned int t : vertexTris[c.from]) {
+            if (!triAlive[t])
+                continue;
+            glm::uvec3& tri = tris[t];
+            if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                triAlive[t] = false;
+                --aliveCount;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == c.from)
+                    tri[k] = c.to;
+            }
+            vertexTris[c.to].push_back(t);
+        }
+        vertexTris[c.from].clear();
+        auto& toTris = vertexTris[c.to];
+        toTris.erase(std::remove_if(toTris.begin(), toTris.end(), [&triAlive](unsigned int t) { return !triAlive[t]; }), toTris.end());
+
+        quadrics[c.to].add(quadrics[c.from]);
+        ++versions[c.from];
+        ++versions[c.to];
+
+        // the costs around `to` changed
+        neighbours.clear();
+        for (unsigned int t : toTris) {
+            for (int k = 0; k < 3; ++k) {
+                if (tris[t][k] != c.to)
+                    neighbours.push_back(tris[t][k]);
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (unsigned int n : neighbours) {
+            pushCollapse(c.to, n);
+            pushCollapse(n, c.to);
+        }
+    }
+
+    if (aliveCount == triangleCount)
+        return false;
+
+    // compact the surviving vertices
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    _dst = BoneWeightedMesh();
+    _dst.hasNormals = _src.hasNormals;
+    _dst.hasUVs = _src.hasUVs;
+    _dst.indices.reserve(aliveCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (!triAlive[t])
+            continue;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = tris[t][k];
+            if (remap[v] == ~0u) {
+                remap[v] = static_cast<unsigned int>(_dst.positions.size());
+                _dst.positions.push_back(_src.positions[v]);
+                if (_src.hasNormals)
+                    _dst.normals.push_back(_src.normals[v]);
+                if (_src.hasUVs)
+                    _dst.uvs.push_back(_src.uvs[v]);
+                _dst.influences.push_back(_src.influences[v]);
+                _dst.weights.push_back(_src.weights[v]);
+            }
+            _dst.indices.push_back(remap[v]);
+        }
+    }
+    assert(_dst.indices.size() == 3 * aliveCount && "live triangle count drifted");
+    return true;
+}
+
+void MeshLODChain::
+build(
+    const BoneWeightedMesh& _mesh,
+    int _levelCount,
+    float _ratio,
+    float _skinWeight,
+    float _firstThreshold
+) {
+    this->levels.clear();
+    this->thresholds.clear();
+    this->levels.push_back(_mesh);
+
+    float threshold = _firstThreshold;
+    while (static_cast<int>(this->levels.size()) < _levelCount) {
+        // cascade from the previous level, much cheaper than from the source every time
+        const BoneWeightedMesh& previous = this->levels.back();
+        size_t target = static_cast<size_t>(previous.indices.size() / 3 * _ratio);
+        BoneWeightedMesh reduced;
+        if (target == 0 || !simplifySkinnedMesh(previous, target, _skinWeight, reduced))
+            break;
+        // stuck on locked seams, not worth a level
+        if (reduced.indices.size() > previous.indices.size() * 0.95f)
+            break;
+        this->levels.push_back(std::move(reduced));
+        this->thresholds.push_back(threshold);
+        threshold *= 0.5f;
+    }
+}
+
+int MeshLODChain::
+selectLevel(float _screenSize) const {
+    int level = 0;
+    while (level < static_cast<int>(this->thresholds.size()) && _screenSize < this->thresholds[level])
+        ++level;
+    return level;
+}
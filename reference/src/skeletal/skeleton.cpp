@@ -8,6 +8,53 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "gltf/tinygltf_helper.h"
+#include "profile/profiler.hpp"
+
+Joint::
+Joint(const Joint& _other, const allocator_type& _alloc) :
+    name(_other.name, _alloc),
+    basePosition(_other.basePosition),
+    baseQuaternion(_other.baseQuaternion),
+    baseScale(_other.baseScale),
+    invBindMatrix(_other.invBindMatrix),
+    position(_other.position),
+    Children(_other.Children, _alloc),
+    Parent(_other.Parent),
+    numChildren(_other.numChildren) {
+}
+
+Joint::
+Joint(Joint&& _other, const allocator_type& _alloc) :
+    name(std::move(_other.name), _alloc),
+    basePosition(_other.basePosition),
+    baseQuaternion(_other.baseQuaternion),
+    baseScale(_other.baseScale),
+    invBindMatrix(_other.invBindMatrix),
+    position(_other.position),
+    Children(std::move(_other.Children), _alloc),
+    Parent(_other.Parent),
+    numChildren(_other.numChildren) {
+}
+
+Skeleton::
+Skeleton(std::pmr::memory_resource* _resource) :
+    joints(_resource),
+    evalOrder(_resource),
+    inverseBindMatrices(_resource) {
+}
+
+size_t Skeleton::
+estimateLoadBytes(const tinygltf::Model& mdl) {
+    if (mdl.skins.empty())
+        return 0;
+    size_t bytes = 0;
+    for (int j_id : mdl.skins[0].joints) {
+        const tinygltf::Node& node = mdl.nodes[j_id];
+        bytes += sizeof(Joint) + sizeof(int) + sizeof(glm::mat4); // joint, eval order, inverse bind
+        bytes += node.name.size() + 1 + node.children.size() * sizeof(int);
+    }
+    return bytes;
+}
 
 bool Skeleton::
 loadFromTinyGLTF(
@@ -15,6 +62,7 @@ loadFromTinyGLTF(
     std::string& warn, 
     std::string& err
 ){
+    PROFILE_ZONE("load: skeleton");
     if (mdl.skins.size() == 0) {
         err = "No skeleton data in file.";
         return false;
@@ -51,7 +99,7 @@ loadFromTinyGLTF(
         std::cout << "Skeleton Joints " << j_id << " Loaded: " << curNode.name << std::endl;
 
         /****************************************My Code ***************************************************/
-        this->joints[j_id].name = curNode.name; // bound name to joint.name
+        this->joints[j_id].name.assign(curNode.name); // bound name to joint.name
         this->root = root_id; // bound root with j_id 
         /****************************************My Code end***************************************************/
 
@@ -119,6 +167,7 @@ loadFromTinyGLTF(
         // Access children of the joints
         /****************************************My Code***************************************************/
         this->joints[j_id].numChildren = curNode.children.size();
+        this->joints[j_id].Children.reserve(curNode.children.size());
 
         std::cout << "Children: ";
         for (size_t j = 0; j < curNode.children.size(); ++j) {
@@ -163,5 +212,38 @@ loadFromTinyGLTF(
 
     /****************************************My Code end***************************************************/
 
+    // Order joints so that FK can run in one pass. Every parentless joint
+    // starts a tree, which covers skins with more than one root.
+    this->evalOrder.clear();
+    this->evalOrder.reserve(this->joints.size());
+    for (int i = 0; i < this->joints.size(); ++i) {
+        if (this->joints[i].Parent != -1)
+            continue;
+        size_t head = this->evalOrder.size();
+        this->evalOrder.push_back(i);
+        while (head < this->evalOrder.size()) {
+            for (int child : this->joints[this->evalOrder[head++]].Children)
+                this->evalOrder.push_back(child);
+        }
+    }
+
+    this->inverseBindMatrices.resize(this->joints.size());
+    for (int i = 0; i < this->joints.size(); ++i) {
+        this->inverseBindMatrices[i] = glm::inverse(this->joints[i].invBindMatrix);
+    }
+
     return true;
 }
+
+glm::mat4 Skeleton::
+getBindLocalTransform(int j_id) const {
+    return this->getLocalTransform(j_id, this->joints[j_id].baseQuaternion);
+}
+
+glm::mat4 Skeleton::
+getLocalTransform(int j_id, const glm::quat& rotation) const {
+    const Joint& joint = this->joints[j_id];
+    glm::mat4 trans = glm::translate(glm::mat4(1.0f), joint.basePosition);
+    trans = trans * glm::mat4_cast(rotation);
+    return glm::scale(trans, joint.baseScale);
+}
@@ -0,0 +1,43 @@
+#include "skeletal/skinning.hpp"
+
+void
+skinVertices(
+    const BoneWeightedMesh& _mesh,
+    const glm::mat4* _palette,
+    size_t _boneCount,
+    glm::vec3* _positions,
+    glm::vec3* _normals
+) {
+    bool skinNormals = _normals && _mesh.hasNormals;
+    for (size_t v = 0; v < _mesh.positions.size(); ++v) {
+        glm::vec4 position(_mesh.positions[v], 1.0f);
+        glm::vec4 skinned(0.0f);
+        glm::vec3 normal(0.0f);
+        bool outside = false;
+        for (int k = 0; k < 4; ++k) {
+            float weight = _mesh.weights[v][k];
+            if (weight == 0.0f)
+                continue;
+            unsigned int j = _mesh.influences[v][k];
+            if (j >= _boneCount) {
+                outside = true;
+                break;
+            }
+            skinned += weight * (_palette[j] * position);
+            if (skinNormals)
+                normal += weight * (glm::mat3(_palette[j]) * _mesh.normals[v]);
+        }
+
+        if (outside) {
+            _positions[v] = _mesh.positions[v];
+            if (skinNormals)
+                _normals[v] = _mesh.normals[v];
+            continue;
+        }
+        _positions[v] = glm::vec3(skinned);
+        if (skinNormals) {
+            float length = glm::length(normal);
+            _normals[v] = length > 0.0f ? normal / length : _mesh.normals[v];
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * Bakes the skinned mesh of a clip into a point cache: `bake [options] MODEL OUT`
+ * 
+ *   --fps F        sampling rate (30)
+ *   --keyframes N  key frame every N frames, for seeking (30)
+ *   --verify       reads the cache back and checks every frame against the
+ *                  error the writer reported
+ * 
+ * See "bake/pointcache.hpp" for the file layout.
+ * */
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "skeletal/skeleton.hpp"
+#include "skeletal/mesh.hpp"
+#include "skeletal/animator.hpp"
+#include "skeletal/asset.hpp"
+#include "skeletal/bounds.hpp"
+#include "skeletal/skinning.hpp"
+#include "bake/pointcache.hpp"
+
+#include "gltf/tinygltf_helper.h"
+
+int main(int argc, char** argv)
+{
+    float fps = 30.0f;
+    int keyframeInterval = 30;
+    bool verify = false;
+    std::string modelPath, outPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fps" && i + 1 < argc)
+            fps = std::stof(argv[++i]);
+        else if (arg == "--keyframes" && i + 1 < argc)
+            keyframeInterval = std::stoi(argv[++i]);
+        else if (arg == "--verify")
+            verify = true;
+        else if (arg.rfind("--", 0) != 0 && modelPath.empty())
+            modelPath = arg;
+        else if (arg.rfind("--", 0) != 0 && outPath.empty())
+            outPath = arg;
+        else {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (modelPath.empty() || outPath.empty() || fps <= 0.0f) {
+        std::cout << "usage: bake [--fps F] [--keyframes N] [--verify] MODEL OUT" << std::endl;
+        return -1;
+    }
+
+    std::string warn, err;
+    std::unique_ptr<SkinnedAsset> asset = loadSkinnedAsset(modelPath, warn, err);
+    if (!warn.empty())
+        std::cout << "LoaderWarning: " << warn << std::endl;
+    if (!asset) {
+        std::cout << "LoaderError: " << err << std::endl;
+        return -1;
+    }
+    const Skeleton& skel = asset->skel;
+    const BoneWeightedMesh& mesh = asset->mesh;
+    const SkeletalAnimator& anim = asset->anim;
+
+    size_t boneCount = skel.getBoneNum();
+    size_t vertexCount = mesh.positions.size();
+    int frameCount = static_cast<int>(std::floor(anim.getDuration() * fps)) + 1;
+    std::vector<glm::mat4> palette(boneCount);
+    std::vector<glm::vec3> positions(vertexCount);
+
+    // quantization box of the whole clip from the posed joint spheres,
+    // palettes only, no vertex is skinned for it
+    SkinnedBounds bounds;
+    bounds.build(mesh, boneCount);
+    glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+    for (int f = 0; f < frameCount; ++f) {
+        anim.computeBonePalette(f / fps, palette.data());
+        glm::vec4 sphere = bounds.computeBound(palette.data());
+        boxMin = glm::min(boxMin, glm::vec3(sphere) - glm::vec3(sphere.w));
+        boxMax = glm::max(boxMax, glm::vec3(sphere) + glm::vec3(sphere.w));
+    }
+    for (const glm::vec3& p : mesh.positions) {
+        // vertices of joints outside the palette stay at their bind position
+        boxMin = glm::min(boxMin, p);
+        boxMax = glm::max(boxMax, p);
+    }
+
+    PointCacheWriter writer;
+    if (!writer.open(outPath, vertexCount, fps, boxMin, boxMax, keyframeInterval, err)) {
+        std::cout << "PointCacheError: " << err << std::endl;
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frameCount; ++f) {
+        anim.computeBonePalette(f / fps, palette.data());
+        skinVertices(mesh, palette.data(), boneCount, positions.data());
+        writer.writeFrame(positions.data());
+    }
+    if (!writer.close(err)) {
+        std::cout << "PointCacheError: " << err << std::endl;
+        return -1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double rawBytes = double(frameCount) * vertexCount * sizeof(glm::vec3);
+    std::cout << "Baked " << frameCount << " frames of " << vertexCount << " vertices in " << seconds << " s into " 
+              << outPath << ": " << writer.getBytesWritten() << " bytes (" 
+              << 100.0 * writer.getBytesWritten() / std::max(rawBytes, 1.0) << "% of raw floats), max error " 
+              << writer.getMaxError() << std::endl;
+
+    if (verify) {
+        PointCacheReader reader;
+        if (!reader.open(outPath, err) || reader.getFrameCount() != uint32_t(frameCount) || reader.getVertexCount() != vertexCount) {
+            std::cout << "PointCacheError: " << (err.empty() ? "header does not match the bake" : err) << std::endl;
+            return -1;
+        }
+        // every frame in order, then one seek into the deltas after a key frame
+        std::vector<glm::vec3> decoded(vertexCount);
+        float roundTripError = 0.0f;
+        auto compare = [&](int f) {
+            anim.computeBonePalette(f / fps, palette.data());
+            skinVertices(mesh, palette.data(), boneCount, positions.data());
+            if (!reader.readFrame(decoded.data(), err))
+                return false;
+            for (size_t v = 0; v < vertexCount; ++v)
+                roundTripError = std::max(roundTripError, glm::length(decoded[v] - positions[v]));
+            return true;
+        };
+        bool ok = true;
+        for (int f = 0; f < frameCount && ok; ++f)
+            ok = compare(f);
+        int seekFrame = std::min(frameCount - 1, keyframeInterval + keyframeInterval / 2);
+        ok = ok && reader.seek(seekFrame, err) && compare(seekFrame);
+        if (!ok) {
+            std::cout << "PointCacheError: " << err << std::endl;
+            return -1;
+        }
+
+        // decoding rounds once more than the writer's own estimate did
+        float tolerance = writer.getMaxError() + 1e-6f * glm::length(boxMax - boxMin);
+        std::cout << "Verified " << frameCount << " frames, max error " << roundTripError << std::endl;
+        if (roundTripError > tolerance) {
+            std::cout << "PointCacheError: decoded positions are off by more than " << writer.getMaxError() << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,449 @@
+/**
+ * Microbenchmarks of loading and evaluating skinned models
+ * 
+ * Runs on every bundled model and on synthetic models of growing size:
+ * parsing, the three loaders (on the heap and on a preallocated arena),
+ * keyframe sampling (sweeping, from half-float keys and at random times),
+ * forward kinematics (full and incremental), the bone palette (from one
+ * clip, packed to halves and from two masked half-skeleton layers), a state
+ * machine driving up to 1024 instances and CPU skinning. A large rig with
+ * only 5% of its joints moving shows what incremental FK saves, and STEP and
+ * CUBICSPLINE variants compare sampling cost across interpolation modes. The
+ * half-float stages also report their precision loss.
+ * 
+ *   bench [--models DIR] [google benchmark flags]
+ * 
+ * The evaluation benchmarks also check the per-frame path makes no heap
+ * allocations once warmed up, and fail (assert in debug builds) if it does.
+ * 
+ * DIR defaults to res/mdl. Results as JSON for tracking over time:
+ *   bench --benchmark_out=bench.json --benchmark_out_format=json
+ * */
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "skeletal/skeleton.hpp"
+#include "skeletal/mesh.hpp"
+#include "skeletal/animator.hpp"
+#include "skeletal/skinning.hpp"
+#include "skeletal/blend.hpp"
+#include "skeletal/graph.hpp"
+#include "skeletal/incremental.hpp"
+#include "skeletal/half.hpp"
+#include "skeletal/simplify.hpp"
+
+#include "memory/alloccount.hpp"
+
+#include "gltf/tinygltf_helper.h"
+#include "gltf/synthetic.hpp"
+
+namespace {
+    // the loaders log every joint, which is not what we measure
+    class QuietStdout
+    {
+    private:
+        std::ostringstream sink;
+        std::streambuf* saved;
+
+    public:
+        QuietStdout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+        ~QuietStdout() { std::cout.rdbuf(saved); }
+    };
+
+    struct LoadedModel {
+        Skeleton skel;
+        BoneWeightedMesh mesh;
+        SkeletalAnimator anim;
+    };
+
+    std::unique_ptr<LoadedModel> loadModel(const tinygltf::Model& _gltf) {
+        QuietStdout quiet;
+        auto loaded = std::make_unique<LoadedModel>();
+        std::string warn, err;
+        if (!loaded->skel.loadFromTinyGLTF(_gltf, warn, err) ||
+            !loaded->mesh.loadFromTinyGLTF(_gltf, warn, err) ||
+            !loaded->anim.loadFromTinyGLTF(_gltf, warn, err, &loaded->skel))
+            return nullptr;
+        return loaded;
+    }
+
+    // a source of models: a file, or a synthetic description
+    struct ModelSource {
+        std::string name;
+        std::string path;
+        SyntheticModelDesc desc;
+
+        bool build(tinygltf::Model& _gltf) const {
+            if (this->path.empty()) {
+                tinygltf_buildSyntheticModel(this->desc, _gltf);
+                return true;
+            }
+            QuietStdout quiet;
+            return tinygltf_parsefile(this->path, _gltf);
+        }
+    };
+
+    // sweeps the clip at 60 fps, wrapping around
+    float nextTime(float& _time, float _duration) {
+        _time += 1.0f / 60.0f;
+        if (_time > _duration)
+            _time = 0.0f;
+        return _time;
+    }
+
+    void BM_ParseFile(benchmark::State& state, const ModelSource& source) {
+        QuietStdout quiet;
+        for (auto _ : state) {
+            tinygltf::Model gltf;
+            benchmark::DoNotOptimize(tinygltf_parsefile(source.path, gltf));
+        }
+        state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(source.path));
+    }
+
+    // with `UseArena` every load allocates from a monotonic arena over one
+    // block sized by Loader::estimateLoadBytes, reused across iterations
+    template<typename Loader, bool UseArena>
+    void BM_Load(benchmark::State& state, const ModelSource& source) {
+        tinygltf::Model gltf;
+        if (!source.build(gltf)) {
+            state.SkipWithError("failed to load model");
+            return;
+        }
+        QuietStdout quiet;
+        Skeleton skel;
+        std::string warn, err;
+        if (!skel.loadFromTinyGLTF(gltf, warn, err)) {
+            state.SkipWithError(err.c_str());
+            return;
+        }
+        std::vector<std::byte> block(UseArena ? Loader::estimateLoadBytes(gltf) : 0);
+        for (auto _ : state) {
+            std::pmr::monotonic_buffer_resource arena(block.data(), block.size());
+            Loader loader(UseArena ? &arena : std::pmr::get_default_resource());
+            if constexpr (std::is_same_v<Loader, SkeletalAnimator>)
+                benchmark::DoNotOptimize(loader.loadFromTinyGLTF(gltf, warn, err, &skel));
+            else
+                benchmark::DoNotOptimize(loader.loadFromTinyGLTF(gltf, warn, err));
+            warn.clear();
+        }
+    }
+
+    enum class Stage { Sample, HalfKeysSample, RandomSample, ForwardKinematics, IncrementalForwardKinematics, Palette, HalfPalette, LayeredPalette, Skinning };
+
+    void BM_Evaluate(benchmark::State& state, const ModelSource& source, Stage stage) {
+        tinygltf::Model gltf;
+        std::unique_ptr<LoadedModel> model;
+        if (!source.build(gltf) || !(model = loadModel(gltf))) {
+            state.SkipWithError("failed to load model");
+            return;
+        }
+        HalfPrecisionError halfError;
+        if (stage == Stage::HalfKeysSample)
+            halfError = model->anim.compressKeyframes();
+        const SkeletalAnimator& anim = model->anim;
+        size_t boneCount = model->skel.getBoneNum();
+        float duration = anim.getDuration();
+
+        std::vector<glm::quat> rotations(boneCount);
+        std::vector<glm::mat4> matrices(boneCount);
+        std::vector<HalfMat4> halfMatrices(boneCount);
+        std::vector<glm::vec3> positions(model->mesh.positions.size());
+        std::vector<glm::vec3> normals(model->mesh.positions.size());
+        // upper/lower body split at the joint halfway down the evaluation order
+        const Skeleton& skel = model->skel;
+        JointMask upper = JointMask::subtree(skel, skel.getEvalOrder()[boneCount / 2]);
+        JointMask lower = upper.inverted(skel);
+        AnimationLayer layers[2];
+        layers[0] = { 0, 0.0f, 1.0f, BlendMode::Override, &lower };
+        layers[1] = { 0, 0.0f, 1.0f, BlendMode::Override, &upper };
+
+        IncrementalPose pose(&anim);
+        // unrelated phases, like scrubbing or many instances: no locality between lookups
+        std::vector<float> randomTimes(4096);
+        for (size_t i = 0; i < randomTimes.size(); ++i)
+            randomTimes[i] = duration * std::fmod(0.6180339887f * (i * 7919 % 4096), 1.0f);
+        size_t randomIndex = 0;
+
+        // also warms up the frame scratch
+        anim.computeBonePalette(0.5f * duration, matrices.data());
+        anim.computeBonePalette(layers, 2, matrices.data());
+        pose.update(0, 0.5f * duration);
+
+        float time = 0.0f;
+        size_t allocations = AllocationCounter::getThreadCount();
+        for (auto _ : state) {
+            switch (stage) {
+            case Stage::Sample:
+                anim.sampleRotations(nextTime(time, duration), rotations.data());
+                benchmark::DoNotOptimize(rotations.data());
+                break;
+            case Stage::HalfKeysSample:
+                anim.sampleRotations(nextTime(time, duration), rotations.data());
+                benchmark::DoNotOptimize(rotations.data());
+                break;
+            case Stage::RandomSample:
+                anim.sampleRotations(randomTimes[randomIndex++ % randomTimes.size()], rotations.data());
+                benchmark::DoNotOptimize(rotations.data());
+                break;
+            case Stage::ForwardKinematics:
+                anim.computeGlobalTransforms(nextTime(time, duration), matrices.data());
+                benchmark::DoNotOptimize(matrices.data());
+                break;
+            case Stage::IncrementalForwardKinematics:
+                pose.update(0, nextTime(time, duration));
+                benchmark::DoNotOptimize(pose.getGlobals());
+                break;
+            case Stage::Palette:
+                anim.computeBonePalette(nextTime(time, duration), matrices.data());
+                benchmark::DoNotOptimize(matrices.data());
+                break;
+            case Stage::HalfPalette:
+                // what gets uploaded, half the bytes
+                anim.computeBonePalette(nextTime(time, duration), matrices.data());
+                packPalette(matrices.data(), boneCount, halfMatrices.data());
+                benchmark::DoNotOptimize(halfMatrices.data());
+                break;
+            case Stage::LayeredPalette:
+                layers[0].time = nextTime(time, duration);
+                layers[1].time = duration - layers[0].time;
+                anim.computeBonePalette(layers, 2, matrices.data());
+                benchmark::DoNotOptimize(matrices.data());
+                break;
+            case Stage::Skinning:
+                // a fixed palette, only the vertex work is measured
+                skinVertices(model->mesh, matrices.data(), boneCount, positions.data(), normals.data());
+                benchmark::DoNotOptimize(positions.data());
+                break;
+            }
+            benchmark::ClobberMemory();
+        }
+        allocations = AllocationCounter::getThreadCount() - allocations;
+        assert(allocations == 0 && "per-frame evaluation allocated");
+        if (allocations > 0) {
+            state.SkipWithError("per-frame evaluation allocated");
+            return;
+        }
+        size_t items = stage == Stage::Skinning ? positions.size() : boneCount;
+        state.SetItemsProcessed(state.iterations() * items);
+        state.counters["joints"] = static_cast<double>(boneCount);
+        state.counters["vertices"] = static_cast<double>(positions.size());
+        if (stage == Stage::IncrementalForwardKinematics)
+            state.counters["dirty"] = static_cast<double>(pose.getDirtyCount());
+        if (stage == Stage::HalfPalette)
+            halfError = measurePaletteError(matrices.data(), boneCount);
+        if (stage == Stage::HalfKeysSample || stage == Stage::HalfPalette) {
+            state.counters["max_error"] = halfError.maxAbsolute;
+            state.counters["max_angle_deg"] = halfError.maxAngle * 180.0 / 3.14159265358979;
+        }
+    }
+
+    // two states of the first clip at different speeds, blended by a parameter
+    // and switched back and forth as it crosses 0.5
+    void BM_Graph(benchmark::State& state, const ModelSource& source, size_t instanceCount) {
+        tinygltf::Model gltf;
+        std::unique_ptr<LoadedModel> model;
+        if (!source.build(gltf) || !(model = loadModel(gltf))) {
+            state.SkipWithError("failed to load model");
+            return;
+        }
+        AnimationGraphDesc desc;
+        desc.parameters = { "blend" };
+        desc.states.resize(2);
+        desc.states[0].name = "slow";
+        desc.states[0].tree.clip = "0";
+        desc.states[0].speed = 0.5f;
+        desc.states[1].name = "fast";
+        desc.states[1].tree.parameter = "blend";
+        desc.states[1].tree.thresholds = { 0.0f, 1.0f };
+        desc.states[1].tree.children.resize(2);
+        desc.states[1].tree.children[0].clip = "0";
+        desc.states[1].tree.children[1].clip = "0";
+        desc.transitions.push_back({ "slow", "fast", "blend", true, 0.5f, 0.25f });
+        desc.transitions.push_back({ "fast", "slow", "blend", false, 0.5f, 0.25f });
+
+        AnimationGraph graph;
+        std::string err;
+        if (!graph.compile(desc, &model->anim, err)) {
+            state.SkipWithError(err.c_str());
+            return;
+        }
+        // large rigs get fewer instances, at most 256k joints in flight
+        instanceCount = std::min(instanceCount, std::max<size_t>(1, (1 << 18) / model->skel.getBoneNum()));
+        AnimationGraphInstances instances;
+        graph.initInstances(instances, instanceCount);
+        std::vector<glm::mat4> palettes(instanceCount * model->skel.getBoneNum());
+        graph.evaluate(instances, 0.0f, palettes.data());
+
+        float time = 0.0f;
+        size_t allocations = AllocationCounter::getThreadCount();
+        for (auto _ : state) {
+            time += 1.0f / 60.0f;
+            for (size_t i = 0; i < instanceCount; ++i)
+                instances.parameter(i, 0) = 0.5f + 0.5f * std::sin(time + 0.37f * i);
+            graph.evaluate(instances, 1.0f / 60.0f, palettes.data());
+            benchmark::DoNotOptimize(palettes.data());
+            benchmark::ClobberMemory();
+        }
+        allocations = AllocationCounter::getThreadCount() - allocations;
+        assert(allocations == 0 && "per-frame evaluation allocated");
+        if (allocations > 0) {
+            state.SkipWithError("per-frame evaluation allocated");
+            return;
+        }
+        state.SetItemsProcessed(state.iterations() * instanceCount);
+        state.counters["instances"] = static_cast<double>(instanceCount);
+    }
+
+    // closed and seamless, so every collapse removes exactly two triangles
+    BoneWeightedMesh buildIcosphere(int _subdivisions) {
+        const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+        BoneWeightedMesh mesh;
+        mesh.hasNormals = false;
+        mesh.hasUVs = false;
+        mesh.positions = { { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+                           { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+                           { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+        mesh.indices = { 0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+                         1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+                         3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+                         4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1 };
+        for (int s = 0; s < _subdivisions; ++s) {
+            std::map<unsigned long long, unsigned int> midpoints;
+            auto midpoint = [&](unsigned int a, unsigned int b) {
+                unsigned long long key = static_cast<unsigned long long>(std::min(a, b)) << 32 | std::max(a, b);
+                auto it = midpoints.find(key);
+                if (it != midpoints.end())
+                    return it->second;
+                mesh.positions.push_back(0.5f * (mesh.positions[a] + mesh.positions[b]));
+                unsigned int index = static_cast<unsigned int>(mesh.positions.size()) - 1;
+                midpoints[key] = index;
+                return index;
+            };
+            decltype(mesh.indices) indices;
+            for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+                unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+                unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+                indices.insert(indices.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+            }
+            mesh.indices = std::move(indices);
+        }
+        for (glm::vec3& p : mesh.positions)
+            p = glm::normalize(p);
+        mesh.influences.assign(mesh.positions.size(), glm::uvec4(0));
+        mesh.weights.assign(mesh.positions.size(), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f));
+        return mesh;
+    }
+
+    // also checks the triangle count lands on the target
+    void BM_Simplify(benchmark::State& state, int subdivisions) {
+        BoneWeightedMesh sphere = buildIcosphere(subdivisions);
+        size_t target = sphere.indices.size() / 3 / 4;
+        BoneWeightedMesh simplified;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(simplifySkinnedMesh(sphere, target, 1.0f, simplified));
+        }
+        size_t triangles = simplified.indices.size() / 3;
+        assert(triangles <= target && triangles + 1 >= target && "simplified off target");
+        if (triangles > target || triangles + 1 < target) {
+            state.SkipWithError(("simplified to " + std::to_string(triangles) + " triangles, target " + std::to_string(target)).c_str());
+            return;
+        }
+        state.SetItemsProcessed(state.iterations() * (sphere.indices.size() / 3 - triangles));
+        state.counters["triangles"] = static_cast<double>(triangles);
+    }
+
+    void registerModel(const ModelSource& source) {
+        if (!source.path.empty())
+            benchmark::RegisterBenchmark(("parse/" + source.name).c_str(), BM_ParseFile, source);
+        benchmark::RegisterBenchmark(("load_skeleton/" + source.name).c_str(), BM_Load<Skeleton, false>, source);
+        benchmark::RegisterBenchmark(("load_mesh/" + source.name).c_str(), BM_Load<BoneWeightedMesh, false>, source);
+        benchmark::RegisterBenchmark(("load_animation/" + source.name).c_str(), BM_Load<SkeletalAnimator, false>, source);
+        benchmark::RegisterBenchmark(("load_skeleton_arena/" + source.name).c_str(), BM_Load<Skeleton, true>, source);
+        benchmark::RegisterBenchmark(("load_mesh_arena/" + source.name).c_str(), BM_Load<BoneWeightedMesh, true>, source);
+        benchmark::RegisterBenchmark(("load_animation_arena/" + source.name).c_str(), BM_Load<SkeletalAnimator, true>, source);
+        benchmark::RegisterBenchmark(("sample/" + source.name).c_str(), BM_Evaluate, source, Stage::Sample);
+        benchmark::RegisterBenchmark(("sample_half/" + source.name).c_str(), BM_Evaluate, source, Stage::HalfKeysSample);
+        benchmark::RegisterBenchmark(("sample_random/" + source.name).c_str(), BM_Evaluate, source, Stage::RandomSample);
+        benchmark::RegisterBenchmark(("fk/" + source.name).c_str(), BM_Evaluate, source, Stage::ForwardKinematics);
+        benchmark::RegisterBenchmark(("fk_incremental/" + source.name).c_str(), BM_Evaluate, source, Stage::IncrementalForwardKinematics);
+        benchmark::RegisterBenchmark(("palette/" + source.name).c_str(), BM_Evaluate, source, Stage::Palette);
+        benchmark::RegisterBenchmark(("palette_half/" + source.name).c_str(), BM_Evaluate, source, Stage::HalfPalette);
+        benchmark::RegisterBenchmark(("palette_layered/" + source.name).c_str(), BM_Evaluate, source, Stage::LayeredPalette);
+        benchmark::RegisterBenchmark(("skin/" + source.name).c_str(), BM_Evaluate, source, Stage::Skinning);
+        benchmark::RegisterBenchmark(("graph/" + source.name).c_str(), BM_Graph, source, 1024);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    std::string modelDir = "res/mdl";
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--models" && i + 1 < argc)
+            modelDir = argv[++i];
+        else {
+            // benchmark::Initialize already removed its own flags
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<ModelSource> sources;
+    if (std::filesystem::is_directory(modelDir)) {
+        for (const auto& entry : std::filesystem::directory_iterator(modelDir)) {
+            std::string extension = entry.path().extension().string();
+            if (extension == ".gltf" || extension == ".glb")
+                sources.push_back({ entry.path().stem().string(), entry.path().string(), {} });
+        }
+    } else {
+        std::cout << "No model directory at " << modelDir << ", running synthetic models only" << std::endl;
+    }
+
+    // joints x vertices
+    const int sizes[][2] = { { 16, 1024 }, { 64, 4096 }, { 256, 16384 }, { 1024, 65536 }, { 10000, 262144 } };
+    for (const auto& size : sizes) {
+        ModelSource source;
+        source.name = "synthetic_j" + std::to_string(size[0]) + "_v" + std::to_string(size[1]);
+        source.desc.jointCount = size[0];
+        source.desc.vertexCount = size[1];
+        sources.push_back(source);
+    }
+    // the other interpolations, spline sampling should cost about what slerp does
+    for (const char* interpolation : { "STEP", "CUBICSPLINE" }) {
+        ModelSource source;
+        source.name = std::string("synthetic_j256_v16384_") + interpolation;
+        source.desc.jointCount = 256;
+        source.desc.vertexCount = 16384;
+        source.desc.interpolation = interpolation;
+        sources.push_back(source);
+    }
+    // a prop rig where few joints move
+    ModelSource partial;
+    partial.name = "synthetic_j1024_v16384_a5";
+    partial.desc.jointCount = 1024;
+    partial.desc.vertexCount = 16384;
+    partial.desc.animatedFraction = 0.05f;
+    sources.push_back(partial);
+
+    for (const ModelSource& source : sources)
+        registerModel(source);
+    for (int subdivisions : { 3, 5 })
+        benchmark::RegisterBenchmark(("simplify/icosphere_s" + std::to_string(subdivisions)).c_str(), BM_Simplify, subdivisions);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
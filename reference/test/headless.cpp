@@ -0,0 +1,178 @@
+/**
+ * Renders a clip without a window: `headless [options]`
+ * 
+ *   --model FILE      glTF to load (res/mdl/dancing_cylinder.gltf)
+ *   --shaders DIR     shader directory (res/shader)
+ *   --frames N        frames to render (120)
+ *   --fps F           clip time step per frame (30)
+ *   --size W H        image size (512 512)
+ *   --out DIR         where frame_XXXX.ppm go (frames)
+ *   --no-write        render and read back, but keep nothing: throughput runs
+ *   --profile FILE    Chrome trace of the whole run
+ * 
+ * The camera orbits the mesh once over the N frames.
+ * */
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "camera/fpc.hpp"
+#include "shader/shader.hpp"
+
+#include "skeletal/skeleton.hpp"
+#include "skeletal/mesh.hpp"
+#include "skeletal/animator.hpp"
+#include "skeletal/asset.hpp"
+#include "pipeline/skeleton.hpp"
+#include "pipeline/mesh.hpp"
+#include "pipeline/queue.hpp"
+#include "pipeline/offscreen.hpp"
+#include "platform/headless.hpp"
+
+#include "gltf/tinygltf_helper.h"
+#include "profile/profiler.hpp"
+#include "memory/usage.hpp"
+
+int main(int argc, char** argv)
+{
+    std::string modelPath = "res/mdl/dancing_cylinder.gltf";
+    std::string shaderDir = "res/shader";
+    std::string outDir = "frames";
+    std::string profilePath;
+    int frameCount = 120;
+    float fps = 30.0f;
+    int width = 512, height = 512;
+    bool writeFrames = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--model" && i + 1 < argc)
+            modelPath = argv[++i];
+        else if (arg == "--shaders" && i + 1 < argc)
+            shaderDir = argv[++i];
+        else if (arg == "--frames" && i + 1 < argc)
+            frameCount = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--fps" && i + 1 < argc)
+            fps = std::max(1.0f, std::stof(argv[++i]));
+        else if (arg == "--size" && i + 2 < argc) {
+            width = std::max(1, std::stoi(argv[++i]));
+            height = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--out" && i + 1 < argc)
+            outDir = argv[++i];
+        else if (arg == "--no-write")
+            writeFrames = false;
+        else if (arg == "--profile" && i + 1 < argc)
+            profilePath = argv[++i];
+        else {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (!profilePath.empty())
+        Profiler::get().enable();
+
+    HeadlessContext context;
+    std::string err;
+    if (!context.create(4, 3, err)) {
+        std::cout << "HeadlessContextError: " << err << std::endl;
+        return -1;
+    }
+    std::cout << "Renderer: " << context.getRenderer() << std::endl;
+
+    Shader shader_skel((shaderDir + "/skeleton.vs").c_str(), (shaderDir + "/skeleton.fs").c_str());
+    Shader shader_mesh((shaderDir + "/mesh.vs").c_str(), (shaderDir + "/mesh.fs").c_str());
+
+    std::string warn;
+    std::unique_ptr<SkinnedAsset> asset = loadSkinnedAsset(modelPath, warn, err);
+    if (!warn.empty())
+        std::cout << "LoaderWarning: " << warn << std::endl;
+    if (!asset) {
+        std::cout << "LoaderError: " << err << std::endl;
+        return -1;
+    }
+    std::cout << "Memory after loading: " << getMemoryUsage() << std::endl;
+    Skeleton& skel = asset->skel;
+    BoneWeightedMesh& mesh = asset->mesh;
+    SkeletalAnimator& anim = asset->anim;
+
+    FirstPersonCamera camera;
+    camera.setAspect(static_cast<float>(width) / height);
+    WireframeMeshPipeline pipeline_mesh(&shader_mesh, &camera, &mesh, &anim);
+    WireframeSkeletonPipeline pipeline_skel(&shader_skel, &camera, &skel, &anim);
+
+    // orbit around the bind pose bounds
+    glm::vec3 boxMin = mesh.positions.empty() ? glm::vec3(0.0f) : mesh.positions[0];
+    glm::vec3 boxMax = boxMin;
+    for (const glm::vec3& p : mesh.positions) {
+        boxMin = glm::min(boxMin, p);
+        boxMax = glm::max(boxMax, p);
+    }
+    glm::vec3 center = 0.5f * (boxMin + boxMax);
+    float radius = std::max(2.0f * glm::length(boxMax - boxMin), 1.0f);
+
+    OffscreenTarget target(width, height);
+    if (!target.isComplete()) {
+        std::cout << "Offscreen framebuffer is incomplete." << std::endl;
+        return -1;
+    }
+    FrameReadback readback(width, height);
+    if (writeFrames)
+        std::filesystem::create_directories(outDir);
+    int written = 0;
+    auto saveFrame = [&](int frame, const unsigned char* rgba, int w, int h) {
+        if (!writeFrames)
+            return;
+        PROFILE_ZONE("write frame");
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%04d.ppm", frame);
+        if (writeImagePPM((std::filesystem::path(outDir) / name).string(), rgba, w, h))
+            ++written;
+        else
+            std::cout << "Failed to write " << name << std::endl;
+    };
+
+    RenderQueue queue;
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        Profiler::get().beginFrame();
+        PROFILE_ZONE("frame");
+
+        float angle = 2.0f * 3.14159265f * frame / frameCount;
+        camera.lookAt(center + radius * glm::vec3(std::sin(angle), 0.3f, std::cos(angle)), center);
+        float duration = anim.getDuration();
+        float time = duration > 0.0f ? std::fmod(frame / fps, duration) : 0.0f;
+
+        target.bind();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        camera.updateFrameConstants();
+        pipeline_skel.record(queue, time);
+        pipeline_mesh.record(queue, time);
+        queue.submit();
+
+        readback.capture(frame, saveFrame);
+        readback.poll(saveFrame);
+    }
+    readback.flush(saveFrame);
+    glFinish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << frameCount << " frames in " << seconds << " s (" << frameCount / seconds << " fps)";
+    if (writeFrames)
+        std::cout << ", " << written << " written to " << outDir;
+    std::cout << std::endl;
+
+    if (!profilePath.empty())
+        Profiler::get().writeChromeTrace(profilePath);
+    return 0;
+}
@@ -1,11 +1,16 @@
 #include <iostream>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <memory>
 #include <string>
 #include <sstream>
 #include <numbers>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "camera/fpc.hpp"
 #include "shader/shader.hpp"
@@ -15,16 +20,71 @@
 
 #include "skeletal/mesh.hpp"
 #include "pipeline/mesh.hpp"
+#include "pipeline/crowd.hpp"
+#include "pipeline/batch.hpp"
+#include "pipeline/queue.hpp"
 
 #include "skeletal/animator.hpp"
+#include "skeletal/asset.hpp"
+#include "skeletal/blend.hpp"
+#include "skeletal/graph.hpp"
+#include "skeletal/bounds.hpp"
+#include "skeletal/lod.hpp"
+#include "skeletal/simplify.hpp"
 // #include "pipeline/animator.hpp"
 
 #include "gltf/tinygltf_helper.h"
+#include "profile/profiler.hpp"
+#include "memory/usage.hpp"
 
 void processCameraInput(GLFWwindow* window, FirstPersonCamera* camera);
 
-int main(void)
+int main(int argc, char** argv)
 {
+    // `main --crowd N` additionally draws N instanced copies of the animated mesh,
+    // `--batch` sends them through the multi-draw-indirect batcher instead,
+    // `--no-anim-lod` animates every instance every frame,
+    // `--overlay CLIP JOINT` plays clip CLIP on the joints under JOINT (say the
+    // upper body) and the first clip on the rest, `--graph FILE` drives the
+    // crowd with an animation state machine instead (see skeletal/graph.hpp).
+    // `--half-palette` uploads the bone palettes as half floats and
+    // `--half-keys` loads rotation keys as halves, both print their error.
+    // Run with and without it to compare the memory printed after loading.
+    // `--profile trace.json` records the first `--profile-frames N` frames (300)
+    // and writes them as a Chrome trace
+    int crowdSize = 0;
+    bool crowdBatched = false;
+    bool crowdAnimLOD = true;
+    std::string profilePath;
+    int profileFrames = 300;
+    int overlayClip = -1, overlayJoint = -1;
+    std::string graphPath;
+    bool halfPalette = false, halfKeys = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--crowd" && i + 1 < argc)
+            crowdSize = std::max(0, std::stoi(argv[i + 1]));
+        else if (std::string(argv[i]) == "--batch")
+            crowdBatched = true;
+        else if (std::string(argv[i]) == "--no-anim-lod")
+            crowdAnimLOD = false;
+        else if (std::string(argv[i]) == "--profile" && i + 1 < argc)
+            profilePath = argv[++i];
+        else if (std::string(argv[i]) == "--profile-frames" && i + 1 < argc)
+            profileFrames = std::max(1, std::stoi(argv[++i]));
+        else if (std::string(argv[i]) == "--half-palette")
+            halfPalette = true;
+        else if (std::string(argv[i]) == "--half-keys")
+            halfKeys = true;
+        else if (std::string(argv[i]) == "--graph" && i + 1 < argc)
+            graphPath = argv[++i];
+        else if (std::string(argv[i]) == "--overlay" && i + 2 < argc) {
+            overlayClip = std::stoi(argv[++i]);
+            overlayJoint = std::stoi(argv[++i]);
+        }
+    }
+    if (!profilePath.empty())
+        Profiler::get().enable();
+
     GLFWwindow* window;
 
     /* Initialize the library */
@@ -56,66 +116,138 @@ int main(void)
     /**** Initiate Objects Here ****/
     Shader shader_skel("E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\skeleton.vs", "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\skeleton.fs");
     /***************************my code*************************/
-    Shader shader_mesh("E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\skeleton.vs", "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\mesh.fs");
+    Shader shader_mesh(halfPalette ? "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\mesh_half.vs" : "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\mesh.vs", "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\mesh.fs");
     /***************************my code end*************************/
-    tinygltf::Model model;
-    if (!tinygltf_parsefile("E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\mdl\\dancing_cylinder.gltf", model)) {
-    // if (!tinygltf_parsefile("E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\mdl\\weaving_flag.gltf", model)) {
-        std::cout<<"failed to load module."<<std::endl;
+    // the parsed model is freed once skeleton, mesh and animation are extracted
+    std::string warn, err;
+    std::cout << "Memory before loading: " << getMemoryUsage() << std::endl;
+    std::unique_ptr<SkinnedAsset> asset = loadSkinnedAsset("E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\mdl\\dancing_cylinder.gltf", warn, err, halfKeys);
+    // std::unique_ptr<SkinnedAsset> asset = loadSkinnedAsset("E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\mdl\\weaving_flag.gltf", warn, err);
+    if (!warn.empty()) {
+        std::cout << "LoaderWarning: " << warn << std::endl;
+        warn.clear();
+    }
+    if (!asset) {
+        std::cout << "LoaderError: " << err << std::endl;
         return -1;
     }
+    std::cout << "Memory after loading: " << getMemoryUsage() << ", asset arena " << asset->arenaBytes / 1024 << " KiB, "
+              << "rotation keys " << asset->anim.getKeyframeBytes() / 1024 << " KiB" << (halfKeys ? " as halves" : "") << std::endl;
+    if (halfKeys)
+        std::cout << "Half-float keyframes: " << asset->anim.getKeyframeError() << std::endl;
 
     FirstPersonCamera camera;
 
     ///////////////
     // Some setups here
-    Skeleton skel;
-    std::string warn, err;
-    if (!skel.loadFromTinyGLTF(model, warn, err)) {
-        std::cout << "SkeletonLoaderError: " << err << std::endl;
-    };
-    if (!warn.empty()) {
-        std::cout << "SkeletonLoaderWarning: " << warn << std::endl;
-        warn.clear();
-    }
+    Skeleton& skel = asset->skel;
     
     // WireframeSkeletonPipeline pipeline_skel(&shader_skel, &camera, &skel);
 
     /***************************my code*************************/
-    BoneWeightedMesh mesh;
-    std::string warn_mesh, err_mesh;
-    if (!mesh.loadFromTinyGLTF(model, warn_mesh, err_mesh)) {
-        std::cout << "MeshLoaderError: " << err_mesh << std::endl;
-    };
-    if (!warn_mesh.empty()) {
-        std::cout << "MeshLoaderWarning: " << warn_mesh << std::endl;
-        warn_mesh.clear();
+    BoneWeightedMesh& mesh = asset->mesh;
+    SkeletalAnimator& anim = asset->anim;
+    WireframeMeshPipeline pipeline_mesh(&shader_mesh, &camera, &mesh, &anim, halfPalette);
+    if (halfPalette) {
+        std::vector<glm::mat4> palette(skel.getBoneNum());
+        anim.computeBonePalette(0.0f, palette.data());
+        std::cout << "Half-float palette, at the first frame: " << measurePaletteError(palette.data(), palette.size()) << std::endl;
     }
+    WireframeSkeletonPipeline pipeline_skel(&shader_skel, &camera, &skel, &anim);
+    /***************************my code end*************************/
 
-    WireframeMeshPipeline pipeline_mesh(&shader_mesh, &camera, &mesh);
+    // crowd laid out on a grid, each instance playing the clip at its own phase
+    std::unique_ptr<Shader> shader_crowd;
+    std::unique_ptr<CrowdMeshPipeline> pipeline_crowd;
+    std::unique_ptr<SkinnedMeshBatcher> batcher;
+    // batched crowds draw a simplified mesh once instances get small
+    MeshLODChain crowdMeshLOD;
+    std::vector<int> batchMeshIds;
+    std::vector<glm::mat4> crowdModels(crowdSize);
+    std::vector<float> crowdPhases(crowdSize);
+    std::vector<glm::mat4> crowdPalettes(crowdSize * skel.getBoneNum());
+    // culling: posed bounds of every instance, and the instances that survived
+    SkinnedBounds crowdBounds;
+    crowdBounds.build(mesh, skel.getBoneNum());
+    std::vector<glm::vec4> crowdSpheres(crowdSize);
+    std::vector<unsigned char> crowdVisible(crowdSize);
+    std::vector<glm::mat4> visibleModels, visiblePalettes;
+    // distant instances keep their last palette for a few frames
+    AnimationLODScheduler crowdLOD(crowdSize);
+    // and the smallest ones only evaluate the joints that carry real skin weight
+    SkeletonLOD crowdSkelLOD(&skel);
+    int crowdCoarseSkel = crowdSkelLOD.addLevelFromInfluence(mesh, 0.01f);
+    // layered playback: each half of the skeleton only samples its own clip
+    bool crowdLayered = overlayClip >= 0 && overlayClip < static_cast<int>(anim.getClipCount()) &&
+                        overlayJoint >= 0 && overlayJoint < static_cast<int>(skel.getBoneNum());
+    JointMask overlayMask, baseMask;
+    if (crowdLayered) {
+        overlayMask = JointMask::subtree(skel, overlayJoint);
+        baseMask = overlayMask.inverted(skel);
+    } else if (overlayClip >= 0) {
+        std::cout << "Ignoring --overlay, there is no clip " << overlayClip << " or joint " << overlayJoint << std::endl;
+    }
+    // or a state machine evaluated for the whole crowd at once
+    AnimationGraph crowdGraph;
+    AnimationGraphInstances crowdGraphState;
+    bool crowdGraphed = false;
+    if (!graphPath.empty()) {
+        AnimationGraphDesc graphDesc;
+        std::string graphErr;
+        if (graphDesc.loadFromJson(graphPath, graphErr) && crowdGraph.compile(graphDesc, &anim, graphErr)) {
+            crowdGraph.initInstances(crowdGraphState, crowdSize);
+            crowdGraphed = true;
+        } else {
+            std::cout << "AnimationGraphError: " << graphErr << std::endl;
+        }
+    }
+    if (crowdSize > 0) {
+        if (crowdBatched) {
+            shader_crowd = std::make_unique<Shader>(halfPalette ? "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\batch_half.vs" : "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\batch.vs", "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\mesh.fs");
+            batcher = std::make_unique<SkinnedMeshBatcher>(shader_crowd.get(), &camera, halfPalette);
+            crowdMeshLOD.build(mesh, 4);
+            for (const BoneWeightedMesh& level : crowdMeshLOD.levels)
+                batchMeshIds.push_back(batcher->addMesh(&level, skel.getBoneNum()));
+            batcher->build();
+        } else {
+            shader_crowd = std::make_unique<Shader>(halfPalette ? "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\crowd_half.vs" : "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\crowd.vs", "E:\\Projects\\OpenGL\\assignment1-skeletal-BradZhone-main\\reference\\res\\shader\\mesh.fs");
+            pipeline_crowd = std::make_unique<CrowdMeshPipeline>(shader_crowd.get(), &camera, &mesh, skel.getBoneNum(), halfPalette);
+        }
 
-    SkeletalAnimator anim;
-    std::string warn_anim, err_anim;
-    if (!anim.loadFromTinyGLTF(model, warn, err, &skel)) {
-        std::cout << "AnimationLoaderError: " << err << std::endl;
-    };
-    if (!warn.empty()) {
-        std::cout << "AnimationLoaderWarning: " << warn << std::endl;
-        warn.clear();
+        int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(crowdSize))));
+        for (int i = 0; i < crowdSize; ++i) {
+            glm::vec3 offset(3.0f * (i % side - side / 2), 0.0f, -3.0f * (i / side + 1));
+            crowdModels[i] = glm::translate(glm::mat4(1.0f), offset);
+            crowdPhases[i] = 0.37f * i;
+        }
+        // sized for every instance being visible, the frame loop never grows them
+        visibleModels.reserve(crowdSize);
+        visiblePalettes.reserve(crowdSize * skel.getBoneNum());
     }
-    //  WireframeMeshPipeline pipeline_mesh(&shader_mesh, &camera, &mesh);
-    WireframeSkeletonPipeline pipeline_skel(&shader_skel, &camera, &skel, &anim);
-    /***************************my code end*************************/
     ///////////////
 
+    // pipelines record their draws here, submitted once per frame
+    RenderQueue queue;
+    int frameIndex = 0;
+    float lastFrameTime = glfwGetTime();
+
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window))
     {
+        if (Profiler::get().isEnabled() && frameIndex++ == profileFrames) {
+            Profiler::get().writeChromeTrace(profilePath);
+            Profiler::get().disable();
+        }
+        Profiler::get().beginFrame();
+        PROFILE_ZONE("frame");
+
         /* Render here */
         glClear(GL_COLOR_BUFFER_BIT);
 
         processCameraInput(window, &camera);
         float curFrameTime = glfwGetTime();
+        float frameDelta = curFrameTime - lastFrameTime;
+        lastFrameTime = curFrameTime;
         float curAnimTime = int(curFrameTime) % 5 + curFrameTime - int(curFrameTime); // so that we have a looped time from 0~5
         // std::cout<<curAnimTime<<std::endl;
         ///////////////////
@@ -126,13 +258,78 @@ int main(void)
         //////////////////
 
 
+        // shared by every pipeline drawn this frame
+        camera.updateFrameConstants();
+
         // update skeleton & mesh
         // draw mesh 
         // draw skeleton 
-        pipeline_skel.draw(curAnimTime);
+        pipeline_skel.record(queue, curAnimTime);
         /***************************my code*************************/
-        pipeline_mesh.draw();
+        pipeline_mesh.record(queue, curAnimTime);
         /***************************my code end*************************/
+
+        if (crowdSize > 0 && anim.getDuration() > 0.0f) {
+            // one zone for the whole crowd, a zone per instance would flood the profiler
+            PROFILE_ZONE("crowd");
+            size_t boneCount = skel.getBoneNum();
+            crowdLOD.beginFrame();
+            if (crowdGraphed) {
+                // every parameter drifts slowly, at each instance's own phase
+                for (int i = 0; i < crowdSize; ++i) {
+                    for (size_t p = 0; p < crowdGraph.getParameterCount(); ++p)
+                        crowdGraphState.parameter(i, p) = 0.5f + 0.5f * std::sin(0.3f * curFrameTime + crowdPhases[i] + p);
+                }
+                crowdGraph.evaluate(crowdGraphState, frameDelta, crowdPalettes.data());
+                for (int i = 0; i < crowdSize; ++i)
+                    crowdSpheres[i] = transformSphere(crowdModels[i], crowdBounds.computeBound(&crowdPalettes[i * boneCount]));
+            }
+            for (int i = 0; i < crowdSize && !crowdGraphed; ++i) {
+                // the level is picked from last update's bounds, which lag by at most 8 frames
+                if (crowdAnimLOD && !crowdLOD.shouldUpdate(i, crowdSpheres[i], camera.getFrameConstants()))
+                    continue;
+                float t = std::fmod(curFrameTime + crowdPhases[i], anim.getDuration());
+                const SkeletonLODLevel* skelLevel = nullptr;
+                if (crowdAnimLOD && crowdLOD.getLevel(i) >= 2)
+                    skelLevel = &crowdSkelLOD.getLevel(crowdCoarseSkel);
+                if (crowdLayered) {
+                    AnimationLayer layers[2];
+                    layers[0] = { 0, t, 1.0f, BlendMode::Override, &baseMask };
+                    layers[1] = { overlayClip, std::fmod(curFrameTime + crowdPhases[i], anim.getDuration(overlayClip)), 
+                                  1.0f, BlendMode::Override, &overlayMask };
+                    anim.computeBonePalette(layers, 2, &crowdPalettes[i * boneCount], skelLevel);
+                } else {
+                    anim.computeBonePalette(t, &crowdPalettes[i * boneCount], skelLevel);
+                }
+                crowdSpheres[i] = transformSphere(crowdModels[i], crowdBounds.computeBound(&crowdPalettes[i * boneCount]));
+            }
+
+            // off-screen instances are neither uploaded nor skinned on the GPU
+            camera.getFrustum().cullSpheres(crowdSpheres.data(), crowdSize, crowdVisible.data());
+
+            if (batcher) {
+                for (int i = 0; i < crowdSize; ++i) {
+                    if (!crowdVisible[i])
+                        continue;
+                    int level = crowdMeshLOD.selectLevel(projectedSphereSize(crowdSpheres[i], camera.getFrameConstants()));
+                    batcher->submit(batchMeshIds[level], crowdModels[i], &crowdPalettes[i * boneCount]);
+                }
+                batcher->record(queue);
+            } else {
+                visibleModels.clear();
+                visiblePalettes.clear();
+                for (int i = 0; i < crowdSize; ++i) {
+                    if (!crowdVisible[i])
+                        continue;
+                    visibleModels.push_back(crowdModels[i]);
+                    visiblePalettes.insert(visiblePalettes.end(), &crowdPalettes[i * boneCount], &crowdPalettes[i * boneCount] + boneCount);
+                }
+                pipeline_crowd->setInstances(visibleModels, visiblePalettes);
+                pipeline_crowd->record(queue);
+            }
+        }
+
+        queue.submit();
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
 
@@ -140,6 +337,10 @@ int main(void)
         glfwPollEvents();
     }
 
+    // closed before the last profiled frame
+    if (Profiler::get().isEnabled())
+        Profiler::get().writeChromeTrace(profilePath);
+
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,119 @@
+/**
+ * Writes synthetic skinned models for stress tests: `stressgen [options] OUT`
+ * 
+ *   --joints N           joint count, up to 10000 (64)
+ *   --branching N        children per joint (2)
+ *   --depth N            deepest joint level, 0 for no limit (0)
+ *   --vertices N         vertex count (4096)
+ *   --influences N       skin weights per vertex, 1 to 4 (4)
+ *   --duration S         clip length in seconds (2)
+ *   --keys-per-second N  key density (30)
+ *   --channels TRS       animated channels, any of t, r, s (r)
+ *   --interpolation I    LINEAR, STEP or CUBICSPLINE (LINEAR)
+ *   --animated F         share of joints that move, 0 to 1 (1)
+ * 
+ * OUT ending in .glb gives a single binary file, .gltf a JSON file with its
+ * buffer next to it in OUT's name with .bin.
+ * */
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+#include "gltf/tinygltf_helper.h"
+#include "gltf/synthetic.hpp"
+
+#define STRESSGEN_MAX_JOINTS 10000
+
+int main(int argc, char** argv)
+{
+    SyntheticModelDesc desc;
+    std::string outPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--joints" && hasValue)
+            desc.jointCount = std::stoi(argv[++i]);
+        else if (arg == "--branching" && hasValue)
+            desc.branching = std::stoi(argv[++i]);
+        else if (arg == "--depth" && hasValue)
+            desc.maxDepth = std::stoi(argv[++i]);
+        else if (arg == "--vertices" && hasValue)
+            desc.vertexCount = std::stoi(argv[++i]);
+        else if (arg == "--influences" && hasValue)
+            desc.influences = std::stoi(argv[++i]);
+        else if (arg == "--duration" && hasValue)
+            desc.duration = std::stof(argv[++i]);
+        else if (arg == "--keys-per-second" && hasValue)
+            desc.keysPerSecond = std::stof(argv[++i]);
+        else if (arg == "--channels" && hasValue) {
+            std::string channels = argv[++i];
+            desc.channels = 0;
+            for (char c : channels) {
+                if (c == 't') desc.channels |= SYNTHETIC_CHANNEL_TRANSLATION;
+                else if (c == 'r') desc.channels |= SYNTHETIC_CHANNEL_ROTATION;
+                else if (c == 's') desc.channels |= SYNTHETIC_CHANNEL_SCALE;
+                else {
+                    std::cout << "Unknown channel '" << c << "', expected t, r or s" << std::endl;
+                    return -1;
+                }
+            }
+        }
+        else if (arg == "--interpolation" && hasValue)
+            desc.interpolation = argv[++i];
+        else if (arg == "--animated" && hasValue)
+            desc.animatedFraction = std::stof(argv[++i]);
+        else if (arg.rfind("--", 0) != 0 && outPath.empty())
+            outPath = arg;
+        else {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    if (outPath.empty()) {
+        std::cout << "usage: stressgen [options] OUT.gltf|OUT.glb" << std::endl;
+        return -1;
+    }
+    if (desc.jointCount < 1 || desc.jointCount > STRESSGEN_MAX_JOINTS) {
+        std::cout << "--joints must be within 1 and " << STRESSGEN_MAX_JOINTS << std::endl;
+        return -1;
+    }
+    if (desc.interpolation != "LINEAR" && desc.interpolation != "STEP" && desc.interpolation != "CUBICSPLINE") {
+        std::cout << "--interpolation must be LINEAR, STEP or CUBICSPLINE" << std::endl;
+        return -1;
+    }
+    if (desc.channels == 0 || desc.duration <= 0.0f || desc.keysPerSecond <= 0.0f) {
+        std::cout << "The clip needs at least one channel and a positive duration and key density" << std::endl;
+        return -1;
+    }
+
+    if (desc.animatedFraction < 0.0f || desc.animatedFraction > 1.0f) {
+        std::cout << "--animated must be within 0 and 1" << std::endl;
+        return -1;
+    }
+
+    tinygltf::Model model;
+    tinygltf_buildSyntheticModel(desc, model);
+
+    std::filesystem::path path(outPath);
+    bool binary = path.extension() == ".glb";
+    if (!binary)
+        model.buffers[0].uri = path.stem().string() + ".bin";
+
+    tinygltf::TinyGLTF writer;
+    if (!writer.WriteGltfSceneToFile(&model, outPath, false, binary, !binary, binary)) {
+        std::cout << "Failed to write " << outPath << std::endl;
+        return -1;
+    }
+
+    size_t keys = 0;
+    for (const auto& sampler : model.animations[0].samplers)
+        keys += model.accessors[sampler.input].count;
+    std::cout << "Wrote " << outPath << ": " << desc.jointCount << " joints, " 
+              << model.accessors[model.meshes[0].primitives[0].attributes["POSITION"]].count << " vertices, "
+              << model.accessors[model.meshes[0].primitives[0].indices].count / 3 << " triangles, "
+              << model.animations[0].channels.size() << " channels, " << keys << " keys, "
+              << model.buffers[0].data.size() << " bytes of buffer data" << std::endl;
+    return 0;
+}